@@ -0,0 +1,528 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include "aio.h"
+
+#ifdef __linux__
+#include <linux/io_uring.h>
+/* IORING_OP_READ is an enum, RW_CUR_POS was introduced in the same release */
+#if defined(__NR_io_uring_setup) && defined(IORING_FEAT_RW_CUR_POS)
+#define HAVE_URING
+#endif
+#endif
+
+#define MAX_THREADS	32
+
+struct queue {
+	struct aio_req *head, *tail;
+};
+
+struct aio {
+	int backend;
+	int depth;
+	int outstanding;		/* submitted but not yet returned by aio_wait */
+	struct queue pending;	/* not yet handed to the kernel or picked up by a worker */
+	struct queue done;
+
+#ifdef HAVE_URING
+	int ring_fd;
+	int inflight;
+	int have_bufs;
+	int broken;				/* -errno once io_uring_enter failed for good */
+	struct aio_req **slots;	/* requests in flight, indexed by user_data */
+	int *free_slots, num_free;
+	unsigned int sq_entries;
+	unsigned int *sq_head, *sq_tail, *sq_mask, *sq_array;
+	unsigned int *cq_head, *cq_tail, *cq_mask;
+	struct io_uring_sqe *sqes;
+	struct io_uring_cqe *cqes;
+	void *sq_ring, *cq_ring;
+	size_t sq_ring_size, cq_ring_size, sqes_size;
+#endif
+
+	pthread_t *threads;
+	int nthreads;
+	int quit;
+	pthread_mutex_t lock;
+	pthread_cond_t work_cond, done_cond;
+};
+
+static void q_push(struct queue *q, struct aio_req *req);
+static struct aio_req *q_pop(struct queue *q);
+
+#ifdef HAVE_URING
+static void q_push_front(struct queue *q, struct aio_req *req);
+static int uring_open(struct aio *aio);
+static void uring_close(struct aio *aio);
+static void uring_wait(struct aio *aio);
+static void uring_fail(struct aio *aio);
+#endif
+
+static int threads_open(struct aio *aio);
+static void threads_close(struct aio *aio);
+static void *worker(void *cls);
+
+
+struct aio *aio_open(int backend, int depth)
+{
+	struct aio *aio;
+
+	if(!(aio = calloc(1, sizeof *aio))) {
+		return 0;
+	}
+	aio->depth = depth > 0 ? depth : 64;
+
+	if(backend == AIO_ANY || backend == AIO_URING) {
+#ifdef HAVE_URING
+		if(uring_open(aio) != -1) {
+			aio->backend = AIO_URING;
+			return aio;
+		}
+#endif
+		if(backend == AIO_URING) {
+			free(aio);
+			return 0;
+		}
+	}
+
+	if(threads_open(aio) == -1) {
+		free(aio);
+		return 0;
+	}
+	aio->backend = AIO_THREADS;
+	return aio;
+}
+
+void aio_close(struct aio *aio)
+{
+	if(!aio) return;
+
+	/* drain anything still in flight, the buffers are about to go away */
+	while(aio_wait(aio));
+
+#ifdef HAVE_URING
+	if(aio->backend == AIO_URING) {
+		uring_close(aio);
+	}
+#endif
+	if(aio->backend == AIO_THREADS) {
+		threads_close(aio);
+	}
+	free(aio);
+}
+
+int aio_backend(struct aio *aio)
+{
+	return aio->backend;
+}
+
+const char *aio_backend_name(int backend)
+{
+	switch(backend) {
+	case AIO_URING:
+		return "io_uring";
+	case AIO_THREADS:
+		return "pread threads";
+	default:
+		break;
+	}
+	return "any";
+}
+
+int aio_register_buffers(struct aio *aio, const struct iovec *iov, int num)
+{
+#ifdef HAVE_URING
+	if(aio->backend == AIO_URING) {
+		if(aio->have_bufs) {
+			syscall(__NR_io_uring_register, aio->ring_fd, IORING_UNREGISTER_BUFFERS, 0, 0);
+			aio->have_bufs = 0;
+		}
+		if(syscall(__NR_io_uring_register, aio->ring_fd, IORING_REGISTER_BUFFERS, iov, num) == -1) {
+			return -1;
+		}
+		aio->have_bufs = 1;
+		return 0;
+	}
+#endif
+	return -1;
+}
+
+void aio_submit(struct aio *aio, struct aio_req *req)
+{
+	req->done = 0;
+	req->result = 0;
+	aio->outstanding++;
+
+	if(aio->backend == AIO_THREADS) {
+		pthread_mutex_lock(&aio->lock);
+		q_push(&aio->pending, req);
+		pthread_cond_signal(&aio->work_cond);
+		pthread_mutex_unlock(&aio->lock);
+	} else {
+		/* batched into the submission ring on the next aio_wait */
+		q_push(&aio->pending, req);
+	}
+}
+
+struct aio_req *aio_wait(struct aio *aio)
+{
+	struct aio_req *req;
+
+	if(!aio->outstanding) {
+		return 0;
+	}
+
+	if(aio->backend == AIO_THREADS) {
+		pthread_mutex_lock(&aio->lock);
+		while(!aio->done.head) {
+			pthread_cond_wait(&aio->done_cond, &aio->lock);
+		}
+		req = q_pop(&aio->done);
+		pthread_mutex_unlock(&aio->lock);
+	} else {
+#ifdef HAVE_URING
+		uring_wait(aio);
+#endif
+		req = q_pop(&aio->done);
+	}
+
+	if(req) {
+		aio->outstanding--;
+	}
+	return req;
+}
+
+static void q_push(struct queue *q, struct aio_req *req)
+{
+	req->next = 0;
+	if(q->tail) {
+		q->tail->next = req;
+	} else {
+		q->head = req;
+	}
+	q->tail = req;
+}
+
+static struct aio_req *q_pop(struct queue *q)
+{
+	struct aio_req *req = q->head;
+
+	if(req) {
+		if(!(q->head = req->next)) {
+			q->tail = 0;
+		}
+		req->next = 0;
+	}
+	return req;
+}
+
+/* ---- io_uring backend ---- */
+#ifdef HAVE_URING
+
+static void q_push_front(struct queue *q, struct aio_req *req)
+{
+	req->next = q->head;
+	q->head = req;
+	if(!q->tail) {
+		q->tail = req;
+	}
+}
+
+static int uring_open(struct aio *aio)
+{
+	int i;
+	struct io_uring_params p;
+	unsigned char *sq, *cq;
+
+	memset(&p, 0, sizeof p);
+	if((aio->ring_fd = syscall(__NR_io_uring_setup, aio->depth, &p)) == -1) {
+		return -1;
+	}
+
+	aio->sq_ring_size = p.sq_off.array + p.sq_entries * sizeof(unsigned int);
+	aio->cq_ring_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	if(p.features & IORING_FEAT_SINGLE_MMAP) {
+		if(aio->cq_ring_size > aio->sq_ring_size) {
+			aio->sq_ring_size = aio->cq_ring_size;
+		}
+		aio->cq_ring_size = aio->sq_ring_size;
+	}
+
+	aio->sq_ring = mmap(0, aio->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+			aio->ring_fd, IORING_OFF_SQ_RING);
+	if(aio->sq_ring == MAP_FAILED) {
+		close(aio->ring_fd);
+		return -1;
+	}
+	if(p.features & IORING_FEAT_SINGLE_MMAP) {
+		aio->cq_ring = aio->sq_ring;
+	} else {
+		aio->cq_ring = mmap(0, aio->cq_ring_size, PROT_READ | PROT_WRITE,
+				MAP_SHARED | MAP_POPULATE, aio->ring_fd, IORING_OFF_CQ_RING);
+		if(aio->cq_ring == MAP_FAILED) {
+			munmap(aio->sq_ring, aio->sq_ring_size);
+			close(aio->ring_fd);
+			return -1;
+		}
+	}
+
+	aio->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+	aio->sqes = mmap(0, aio->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+			aio->ring_fd, IORING_OFF_SQES);
+	if(aio->sqes == MAP_FAILED) {
+		if(aio->cq_ring != aio->sq_ring) {
+			munmap(aio->cq_ring, aio->cq_ring_size);
+		}
+		munmap(aio->sq_ring, aio->sq_ring_size);
+		close(aio->ring_fd);
+		return -1;
+	}
+
+	sq = aio->sq_ring;
+	cq = aio->cq_ring;
+	aio->sq_head = (unsigned int*)(sq + p.sq_off.head);
+	aio->sq_tail = (unsigned int*)(sq + p.sq_off.tail);
+	aio->sq_mask = (unsigned int*)(sq + p.sq_off.ring_mask);
+	aio->sq_array = (unsigned int*)(sq + p.sq_off.array);
+	aio->cq_head = (unsigned int*)(cq + p.cq_off.head);
+	aio->cq_tail = (unsigned int*)(cq + p.cq_off.tail);
+	aio->cq_mask = (unsigned int*)(cq + p.cq_off.ring_mask);
+	aio->cqes = (struct io_uring_cqe*)(cq + p.cq_off.cqes);
+
+	aio->sq_entries = p.sq_entries;
+	if(aio->depth > p.sq_entries) {
+		aio->depth = p.sq_entries;
+	}
+
+	aio->slots = calloc(aio->depth, sizeof *aio->slots);
+	aio->free_slots = malloc(aio->depth * sizeof *aio->free_slots);
+	if(!aio->slots || !aio->free_slots) {
+		uring_close(aio);
+		return -1;
+	}
+	for(i=0; i<aio->depth; i++) {
+		aio->free_slots[i] = i;
+	}
+	aio->num_free = aio->depth;
+	return 0;
+}
+
+static void uring_close(struct aio *aio)
+{
+	munmap(aio->sqes, aio->sqes_size);
+	if(aio->cq_ring != aio->sq_ring) {
+		munmap(aio->cq_ring, aio->cq_ring_size);
+	}
+	munmap(aio->sq_ring, aio->sq_ring_size);
+	close(aio->ring_fd);
+	free(aio->slots);
+	free(aio->free_slots);
+}
+
+/* move as many pending requests into the submission ring as fit */
+static int uring_fill(struct aio *aio)
+{
+	int num = 0, slot;
+	unsigned int idx, tail, head;
+	struct aio_req *req;
+	struct io_uring_sqe *sqe;
+
+	tail = *aio->sq_tail;
+	head = __atomic_load_n(aio->sq_head, __ATOMIC_ACQUIRE);
+
+	while(aio->pending.head && aio->inflight < aio->depth && tail - head < aio->sq_entries) {
+		req = q_pop(&aio->pending);
+
+		idx = tail & *aio->sq_mask;
+		sqe = aio->sqes + idx;
+		memset(sqe, 0, sizeof *sqe);
+
+		if(req->buf_index >= 0 && aio->have_bufs) {
+			sqe->opcode = IORING_OP_READ_FIXED;
+			sqe->buf_index = req->buf_index;
+		} else {
+			sqe->opcode = IORING_OP_READ;
+		}
+		sqe->fd = req->fd;
+		sqe->off = req->offset + req->done;
+		sqe->addr = (uintptr_t)req->buf + req->done;
+		sqe->len = req->size - req->done;
+
+		slot = aio->free_slots[--aio->num_free];
+		aio->slots[slot] = req;
+		sqe->user_data = slot;
+
+		aio->sq_array[idx] = idx;
+		tail++;
+		aio->inflight++;
+		num++;
+	}
+
+	__atomic_store_n(aio->sq_tail, tail, __ATOMIC_RELEASE);
+	return num;
+}
+
+static void uring_wait(struct aio *aio)
+{
+	int slot;
+	unsigned int head, tail, to_submit;
+	struct io_uring_cqe *cqe;
+	struct aio_req *req;
+
+	while(!aio->done.head) {
+		if(aio->broken) {
+			uring_fail(aio);
+			return;
+		}
+		uring_fill(aio);
+
+		/* everything published but not consumed yet, including entries left
+		 * over from an earlier call that was interrupted
+		 */
+		to_submit = *aio->sq_tail - __atomic_load_n(aio->sq_head, __ATOMIC_ACQUIRE);
+		if(syscall(__NR_io_uring_enter, aio->ring_fd, to_submit, 1, IORING_ENTER_GETEVENTS,
+					0, 0) == -1) {
+			/* EAGAIN and EBUSY ask for completions to be reaped first */
+			if(errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+				aio->broken = -errno;
+				continue;
+			}
+		}
+
+		head = *aio->cq_head;
+		tail = __atomic_load_n(aio->cq_tail, __ATOMIC_ACQUIRE);
+		while(head != tail) {
+			cqe = aio->cqes + (head & *aio->cq_mask);
+			slot = cqe->user_data;
+			req = aio->slots[slot];
+			aio->slots[slot] = 0;
+			aio->free_slots[aio->num_free++] = slot;
+			head++;
+			aio->inflight--;
+
+			if(cqe->res < 0) {
+				req->result = cqe->res;
+			} else {
+				req->done += cqe->res;
+				if(cqe->res > 0 && req->done < req->size) {
+					/* short read, queue the rest */
+					q_push_front(&aio->pending, req);
+					continue;
+				}
+				req->result = req->done;
+			}
+			q_push(&aio->done, req);
+		}
+		__atomic_store_n(aio->cq_head, head, __ATOMIC_RELEASE);
+	}
+}
+
+/* the ring is unusable, fail everything still pending or in flight */
+static void uring_fail(struct aio *aio)
+{
+	int i;
+	struct aio_req *req;
+
+	while((req = q_pop(&aio->pending))) {
+		req->result = aio->broken;
+		q_push(&aio->done, req);
+	}
+	for(i=0; i<aio->depth; i++) {
+		if((req = aio->slots[i])) {
+			req->result = aio->broken;
+			q_push(&aio->done, req);
+			aio->slots[i] = 0;
+			aio->free_slots[aio->num_free++] = i;
+		}
+	}
+	aio->inflight = 0;
+}
+#endif	/* HAVE_URING */
+
+/* ---- pread thread pool backend ---- */
+
+static int threads_open(struct aio *aio)
+{
+	int i;
+
+	aio->nthreads = aio->depth < MAX_THREADS ? aio->depth : MAX_THREADS;
+	if(!(aio->threads = malloc(aio->nthreads * sizeof *aio->threads))) {
+		return -1;
+	}
+	pthread_mutex_init(&aio->lock, 0);
+	pthread_cond_init(&aio->work_cond, 0);
+	pthread_cond_init(&aio->done_cond, 0);
+
+	for(i=0; i<aio->nthreads; i++) {
+		if(pthread_create(aio->threads + i, 0, worker, aio) != 0) {
+			break;
+		}
+	}
+	if(!(aio->nthreads = i)) {
+		threads_close(aio);
+		return -1;
+	}
+	return 0;
+}
+
+static void threads_close(struct aio *aio)
+{
+	int i;
+
+	pthread_mutex_lock(&aio->lock);
+	aio->quit = 1;
+	pthread_cond_broadcast(&aio->work_cond);
+	pthread_mutex_unlock(&aio->lock);
+
+	for(i=0; i<aio->nthreads; i++) {
+		pthread_join(aio->threads[i], 0);
+	}
+	free(aio->threads);
+
+	pthread_mutex_destroy(&aio->lock);
+	pthread_cond_destroy(&aio->work_cond);
+	pthread_cond_destroy(&aio->done_cond);
+}
+
+static void *worker(void *cls)
+{
+	struct aio *aio = cls;
+	struct aio_req *req;
+	ssize_t rd = 0;
+
+	pthread_mutex_lock(&aio->lock);
+	for(;;) {
+		while(!aio->pending.head && !aio->quit) {
+			pthread_cond_wait(&aio->work_cond, &aio->lock);
+		}
+		if(!(req = q_pop(&aio->pending))) {
+			break;
+		}
+		pthread_mutex_unlock(&aio->lock);
+
+		rd = 0;
+		while(req->done < req->size) {
+			rd = pread(req->fd, (char*)req->buf + req->done, req->size - req->done,
+					req->offset + req->done);
+			if(rd == -1) {
+				if(errno == EINTR) continue;
+				break;
+			}
+			if(!rd) break;
+			req->done += rd;
+		}
+		req->result = rd == -1 ? -errno : (ssize_t)req->done;
+
+		pthread_mutex_lock(&aio->lock);
+		q_push(&aio->done, req);
+		pthread_cond_signal(&aio->done_cond);
+	}
+	pthread_mutex_unlock(&aio->lock);
+	return 0;
+}
@@ -0,0 +1,57 @@
+#ifndef AIO_H_
+#define AIO_H_
+
+#include <stddef.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+/* Asynchronous file reads, batched through io_uring where the kernel
+ * supports it, or serviced by a pool of pread threads otherwise.
+ */
+
+enum {
+	AIO_ANY,		/* io_uring if available, threads otherwise */
+	AIO_URING,
+	AIO_THREADS
+};
+
+struct aio_req {
+	int fd;
+	off_t offset;
+	void *buf;
+	size_t size;
+	int buf_index;	/* registered buffer containing buf, -1 if none */
+	void *udata;
+
+	ssize_t result;	/* bytes read, or -errno on failure */
+
+	/* private */
+	size_t done;
+	struct aio_req *next;
+};
+
+struct aio;
+
+/* depth is the maximum number of reads in flight. Returns 0 if the requested
+ * backend is not available.
+ */
+struct aio *aio_open(int backend, int depth);
+void aio_close(struct aio *aio);
+
+int aio_backend(struct aio *aio);
+const char *aio_backend_name(int backend);
+
+/* register buffers with the kernel, so that reads into them can skip
+ * mapping the pages on every request. Replaces any previous registration.
+ * Returns -1 if registration isn't possible, which is not fatal: requests
+ * with buf_index -1 work regardless.
+ */
+int aio_register_buffers(struct aio *aio, const struct iovec *iov, int num);
+
+/* queue a read. The request must stay valid until it's returned by aio_wait */
+void aio_submit(struct aio *aio, struct aio_req *req);
+
+/* wait for the next completed request. Returns 0 when nothing is outstanding */
+struct aio_req *aio_wait(struct aio *aio);
+
+#endif	/* AIO_H_ */
@@ -0,0 +1,247 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <GL/glew.h>
+#include "bench.h"
+#include "texture.h"
+#include "sdr.h"
+
+#ifndef GL_TEXTURE_MAX_ANISOTROPY_EXT
+#define GL_TEXTURE_MAX_ANISOTROPY_EXT		0x84fe
+#define GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT	0x84ff
+#endif
+
+/* passes timed per combination, after one untimed warm-up pass */
+#define NUM_PASSES	4
+
+/* full-screen triangle out of gl_VertexID, no vertex data needed */
+static const char *vsdr_src =
+	"#version 140\n"
+	"void main()\n"
+	"{\n"
+	"	vec2 p = vec2(float((gl_VertexID & 1) << 2), float((gl_VertexID & 2) << 1));\n"
+	"	gl_Position = vec4(p - 1.0, 0.0, 1.0);\n"
+	"}\n";
+
+/* uvscale is the change in texture coordinates from one pixel to the next.
+ * The gradients are passed explicitly, so the level selected only depends
+ * on the scale and not on how scattered the coordinates are.
+ */
+static const char *psdr_src =
+	"#version 140\n"
+	"uniform sampler2D tex;\n"
+	"uniform vec2 uvscale;\n"
+	"uniform int pattern;\n"
+	"out vec4 color;\n"
+	"vec2 hash2(uvec2 p)\n"
+	"{\n"
+	"	uint h = p.x * 1664525u + p.y * 1013904223u;\n"
+	"	h ^= h >> 16u;\n"
+	"	h *= 0x7feb352du;\n"
+	"	h ^= h >> 15u;\n"
+	"	h *= 0x846ca68bu;\n"
+	"	h ^= h >> 16u;\n"
+	"	return vec2(float(h & 0xffffu), float(h >> 16u)) / 65536.0;\n"
+	"}\n"
+	"void main()\n"
+	"{\n"
+	"	vec2 p = gl_FragCoord.xy;\n"
+	"	vec2 uv;\n"
+	"	if(pattern == 0) {\n"
+	"		uv = p * uvscale;\n"
+	"	} else if(pattern == 1) {\n"
+	"		uv = hash2(uvec2(p) / 8u) + mod(p, 8.0) * uvscale;\n"
+	"	} else {\n"
+	"		uv = hash2(uvec2(p));\n"
+	"	}\n"
+	"	color = textureGrad(tex, uv, vec2(uvscale.x, 0.0), vec2(0.0, uvscale.y));\n"
+	"}\n";
+
+enum { FILT_NEAREST, FILT_LINEAR, FILT_TRILINEAR, FILT_ANISO, NUM_FILTERS };
+static const char *filter_names[] = {"nearest", "linear", "trilinear", "aniso"};
+
+/* texels per pixel */
+static const struct {
+	const char *name;
+	float scale;
+} scales[] = {
+	{"mag", 0.25f},
+	{"1:1", 1.0f},
+	{"min", 4.0f}
+};
+#define NUM_SCALES	(sizeof scales / sizeof *scales)
+
+enum { PAT_COHERENT, PAT_BLOCKS, PAT_RANDOM, NUM_PATTERNS };
+static const char *pattern_names[] = {"coherent", "8x8 blocks", "random"};
+
+static void set_filter(int filt, int levels);
+static double run_passes(int num);
+
+static unsigned int prog, fbo, fbtex, vao, query;
+static int uvscale_loc, pattern_loc;
+static int fb_size;
+static int have_timer, have_aniso;
+static float max_aniso;
+
+
+int bench_init(int size)
+{
+	if(!GLEW_VERSION_3_1) {
+		fprintf(stderr, "the sampling benchmark needs OpenGL 3.1\n");
+		return -1;
+	}
+	if(!(prog = create_program(vsdr_src, psdr_src, 0))) {
+		return -1;
+	}
+	uvscale_loc = glGetUniformLocation(prog, "uvscale");
+	pattern_loc = glGetUniformLocation(prog, "pattern");
+	glUseProgram(prog);
+	glUniform1i(glGetUniformLocation(prog, "tex"), 0);
+	glUseProgram(0);
+
+	fb_size = size;
+	glGenTextures(1, &fbtex);
+	glBindTexture(GL_TEXTURE_2D, fbtex);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glGenFramebuffers(1, &fbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, fbtex, 0);
+	if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		fprintf(stderr, "incomplete benchmark framebuffer (%dx%d)\n", size, size);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		bench_destroy();
+		return -1;
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	glGenVertexArrays(1, &vao);
+
+	if((have_timer = GLEW_VERSION_3_3 || GLEW_ARB_timer_query)) {
+		glGenQueries(1, &query);
+	}
+	if((have_aniso = GLEW_EXT_texture_filter_anisotropic)) {
+		glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &max_aniso);
+	}
+	return 0;
+}
+
+void bench_destroy(void)
+{
+	if(query) glDeleteQueries(1, &query);
+	if(vao) glDeleteVertexArrays(1, &vao);
+	if(fbo) glDeleteFramebuffers(1, &fbo);
+	if(fbtex) glDeleteTextures(1, &fbtex);
+	if(prog) glDeleteProgram(prog);
+	query = vao = fbo = fbtex = prog = 0;
+}
+
+int bench_texture(unsigned int tex, int width, int height, int levels, FILE *fp)
+{
+	int filt, pat, vp[4];
+	unsigned int sc;
+	double msec, rate;
+
+	fprintf(fp, "  %dx%d passes, %d per measurement, %s\n", fb_size, fb_size, NUM_PASSES,
+			have_timer ? "GPU timer queries" : "CPU timing (no timer queries)");
+	fprintf(fp, "  %-10s %-6s %-11s %12s %10s\n", "filter", "scale", "pattern", "Mlookups/s", "ms/pass");
+
+	glGetIntegerv(GL_VIEWPORT, vp);
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glViewport(0, 0, fb_size, fb_size);
+	glUseProgram(prog);
+	glBindVertexArray(vao);
+	glBindTexture(GL_TEXTURE_2D, tex);
+
+	for(filt=0; filt<NUM_FILTERS; filt++) {
+		if(filt == FILT_ANISO && !have_aniso) {
+			fprintf(fp, "  %-10s not supported\n", filter_names[filt]);
+			continue;
+		}
+		set_filter(filt, levels);
+
+		for(sc=0; sc<NUM_SCALES; sc++) {
+			/* anisotropic filtering only matters for a stretched footprint */
+			float sx = scales[sc].scale * (filt == FILT_ANISO ? 4.0f : 1.0f);
+			glUniform2f(uvscale_loc, sx / width, scales[sc].scale / height);
+
+			for(pat=0; pat<NUM_PATTERNS; pat++) {
+				glUniform1i(pattern_loc, pat);
+
+				run_passes(1);	/* warm up */
+				msec = run_passes(NUM_PASSES);
+
+				/* one filtered lookup per pixel. The texels each lookup reads depend
+				 * on the filter, so rates are comparable across patterns and scales,
+				 * not across filters
+				 */
+				rate = msec > 0.0 ? (double)fb_size * fb_size * NUM_PASSES / (msec * 1000.0) : 0.0;
+				fprintf(fp, "  %-10s %-6s %-11s %12.1f %10.3f\n", filter_names[filt],
+						scales[sc].name, pattern_names[pat], rate, msec / NUM_PASSES);
+			}
+		}
+	}
+
+	glBindVertexArray(0);
+	glUseProgram(0);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glViewport(vp[0], vp[1], vp[2], vp[3]);
+	return 0;
+}
+
+static void set_filter(int filt, int levels)
+{
+	int mip = levels > 1;
+	unsigned int min, mag;
+
+	switch(filt) {
+	case FILT_NEAREST:
+		min = mip ? GL_NEAREST_MIPMAP_NEAREST : GL_NEAREST;
+		mag = GL_NEAREST;
+		break;
+	case FILT_LINEAR:
+		min = mip ? GL_LINEAR_MIPMAP_NEAREST : GL_LINEAR;
+		mag = GL_LINEAR;
+		break;
+	default:
+		min = mip ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR;
+		mag = GL_LINEAR;
+		break;
+	}
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, min);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, mag);
+	if(have_aniso) {
+		glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT,
+				filt == FILT_ANISO ? max_aniso : 1.0f);
+	}
+}
+
+/* time num full-screen passes in milliseconds */
+static double run_passes(int num)
+{
+	int i;
+	double t0;
+	GLuint64 nsec;
+
+	if(have_timer) {
+		glBeginQuery(GL_TIME_ELAPSED, query);
+		for(i=0; i<num; i++) {
+			glDrawArrays(GL_TRIANGLES, 0, 3);
+		}
+		glEndQuery(GL_TIME_ELAPSED);
+		glGetQueryObjectui64v(query, GL_QUERY_RESULT, &nsec);
+		return nsec / 1000000.0;
+	}
+
+	glFinish();
+	t0 = get_msec();
+	for(i=0; i<num; i++) {
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+	}
+	glFinish();
+	return get_msec() - t0;
+}
@@ -0,0 +1,18 @@
+#ifndef BENCH_H_
+#define BENCH_H_
+
+#include <stdio.h>
+
+/* texture sampling benchmark: full-screen passes into a size x size
+ * offscreen framebuffer, sampling the texture once per pixel
+ */
+int bench_init(int size);
+void bench_destroy(void);
+
+/* sweep filtering modes, scale and access pattern for one texture, timing
+ * each combination with timer queries where available, and print a line
+ * per combination to fp. Changes the filtering state of tex.
+ */
+int bench_texture(unsigned int tex, int width, int height, int levels, FILE *fp);
+
+#endif	/* BENCH_H_ */
@@ -0,0 +1,389 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <ctype.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/mman.h>
+#include "cache.h"
+
+struct entry {
+	char *name;
+	size_t size;
+	long long mtime;	/* nanoseconds */
+};
+
+struct cache {
+	char *dir;
+	size_t max_size;
+	/* running total of the entry sizes. Other processes sharing the
+	 * directory aren't accounted for until the next scan, which happens
+	 * whenever this goes over max_size.
+	 */
+	size_t cur_size;
+};
+
+static void evict(struct cache *cache);
+static int entry_name(struct cache *cache, char *buf, size_t bufsz, uint64_t key, const char *kind);
+static int is_entry(const char *name);
+static int is_tmp(const char *name);
+
+/* kinds of entries stored in the cache. Only files named like one of these
+ * entries, or like a temporary file of cache_store, are ever counted or
+ * deleted. Anything else in the directory is left alone.
+ */
+static const char *kinds[] = {"tc", "ver", 0};
+
+/* temporary files older than this (seconds) were left behind by a writer
+ * that died before renaming them into place
+ */
+#define TMP_MAX_AGE	3600
+
+
+struct cache *cache_open(const char *dir, size_t max_bytes)
+{
+	struct cache *cache;
+
+	if(mkdir(dir, 0775) == -1 && errno != EEXIST) {
+		fprintf(stderr, "failed to create cache directory: %s: %s\n", dir, strerror(errno));
+		return 0;
+	}
+	if(access(dir, R_OK | W_OK | X_OK) == -1) {
+		fprintf(stderr, "cache directory %s is not accessible: %s\n", dir, strerror(errno));
+		return 0;
+	}
+
+	if(!(cache = calloc(1, sizeof *cache)) || !(cache->dir = malloc(strlen(dir) + 1))) {
+		fprintf(stderr, "failed to allocate cache\n");
+		free(cache);
+		return 0;
+	}
+	strcpy(cache->dir, dir);
+	cache->max_size = max_bytes;
+
+	evict(cache);	/* count what's already in there */
+	return cache;
+}
+
+void cache_close(struct cache *cache)
+{
+	if(!cache) return;
+
+	free(cache->dir);
+	free(cache);
+}
+
+#define P1	11400714785074694791ULL
+#define P2	14029467366897019727ULL
+#define P3	1609587929392839161ULL
+#define P4	9650029242287828579ULL
+#define P5	2870177450012600261ULL
+
+#define ROTL(x, r)	(((x) << (r)) | ((x) >> (64 - (r))))
+
+static uint64_t read64(const unsigned char *p)
+{
+	uint64_t v;
+	memcpy(&v, p, sizeof v);
+	return v;
+}
+
+static uint32_t read32(const unsigned char *p)
+{
+	uint32_t v;
+	memcpy(&v, p, sizeof v);
+	return v;
+}
+
+static uint64_t xxh_round(uint64_t acc, uint64_t in)
+{
+	acc += in * P2;
+	acc = ROTL(acc, 31);
+	return acc * P1;
+}
+
+static uint64_t xxh_merge(uint64_t acc, uint64_t val)
+{
+	acc ^= xxh_round(0, val);
+	return acc * P1 + P4;
+}
+
+uint64_t cache_hash(const void *data, size_t size, uint64_t seed)
+{
+	const unsigned char *p = data;
+	const unsigned char *end = p + size;
+	uint64_t h;
+
+	if(size >= 32) {
+		const unsigned char *limit = end - 32;
+		uint64_t v1 = seed + P1 + P2;
+		uint64_t v2 = seed + P2;
+		uint64_t v3 = seed;
+		uint64_t v4 = seed - P1;
+
+		do {
+			v1 = xxh_round(v1, read64(p));
+			v2 = xxh_round(v2, read64(p + 8));
+			v3 = xxh_round(v3, read64(p + 16));
+			v4 = xxh_round(v4, read64(p + 24));
+			p += 32;
+		} while(p <= limit);
+
+		h = ROTL(v1, 1) + ROTL(v2, 7) + ROTL(v3, 12) + ROTL(v4, 18);
+		h = xxh_merge(h, v1);
+		h = xxh_merge(h, v2);
+		h = xxh_merge(h, v3);
+		h = xxh_merge(h, v4);
+	} else {
+		h = seed + P5;
+	}
+	h += size;
+
+	while(p + 8 <= end) {
+		h ^= xxh_round(0, read64(p));
+		h = ROTL(h, 27) * P1 + P4;
+		p += 8;
+	}
+	if(p + 4 <= end) {
+		h ^= read32(p) * P1;
+		h = ROTL(h, 23) * P2 + P3;
+		p += 4;
+	}
+	while(p < end) {
+		h ^= *p++ * P5;
+		h = ROTL(h, 11) * P1;
+	}
+
+	h ^= h >> 33;
+	h *= P2;
+	h ^= h >> 29;
+	h *= P3;
+	h ^= h >> 32;
+	return h;
+}
+
+void *cache_map(struct cache *cache, uint64_t key, const char *kind, size_t *size)
+{
+	int fd;
+	char path[1024];
+	struct stat st;
+	void *data;
+
+	if(!cache || entry_name(cache, path, sizeof path, key, kind) == -1) {
+		return 0;
+	}
+	if((fd = open(path, O_RDONLY)) == -1) {
+		return 0;
+	}
+	if(fstat(fd, &st) == -1 || st.st_size <= 0) {
+		close(fd);
+		return 0;
+	}
+	data = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(data == MAP_FAILED) {
+		return 0;
+	}
+
+	/* bump the modification time, eviction uses it as the LRU timestamp */
+	utimes(path, 0);
+
+	*size = st.st_size;
+	return data;
+}
+
+void cache_unmap(void *data, size_t size)
+{
+	if(data) {
+		munmap(data, size);
+	}
+}
+
+int cache_store(struct cache *cache, uint64_t key, const char *kind, const void *data,
+		size_t size)
+{
+	int fd;
+	char path[1024], tmppath[1024];
+	const char *ptr = data;
+	ssize_t wr;
+	size_t entsize = size;
+	struct stat st;
+
+	if(!cache || entry_name(cache, path, sizeof path, key, kind) == -1) {
+		return -1;
+	}
+	snprintf(tmppath, sizeof tmppath, "%s/.tmp-XXXXXX", cache->dir);
+
+	/* write to a temporary file and rename it into place, so that readers
+	 * never see a partial entry
+	 */
+	if((fd = mkstemp(tmppath)) == -1) {
+		fprintf(stderr, "failed to create cache entry: %s: %s\n", tmppath, strerror(errno));
+		return -1;
+	}
+	while(size > 0) {
+		if((wr = write(fd, ptr, size)) == -1) {
+			if(errno == EINTR) continue;
+			fprintf(stderr, "failed to write cache entry: %s: %s\n", path, strerror(errno));
+			close(fd);
+			unlink(tmppath);
+			return -1;
+		}
+		ptr += wr;
+		size -= wr;
+	}
+	fchmod(fd, 0664);
+	close(fd);
+
+	/* replacing an entry frees the space of the old one */
+	if(stat(path, &st) == 0 && (size_t)st.st_size <= cache->cur_size) {
+		cache->cur_size -= st.st_size;
+	}
+	if(rename(tmppath, path) == -1) {
+		fprintf(stderr, "failed to rename cache entry: %s: %s\n", path, strerror(errno));
+		unlink(tmppath);
+		return -1;
+	}
+
+	cache->cur_size += entsize;
+	if(cache->max_size && cache->cur_size > cache->max_size) {
+		evict(cache);
+	}
+	return 0;
+}
+
+static int known_kind(const char *kind)
+{
+	int i;
+
+	for(i=0; kinds[i]; i++) {
+		if(strcmp(kinds[i], kind) == 0) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+static int entry_name(struct cache *cache, char *buf, size_t bufsz, uint64_t key, const char *kind)
+{
+	int len;
+
+	if(!known_kind(kind)) {
+		fprintf(stderr, "unknown cache entry kind: %s\n", kind);
+		return -1;
+	}
+	len = snprintf(buf, bufsz, "%s/%016llx.%s", cache->dir, (unsigned long long)key, kind);
+	return len < 0 || len >= bufsz ? -1 : 0;
+}
+
+/* 16 hex digits, a dot, and a known kind, as written by entry_name */
+static int is_entry(const char *name)
+{
+	int i;
+
+	for(i=0; i<16; i++) {
+		if(!isxdigit((unsigned char)name[i]) || isupper((unsigned char)name[i])) {
+			return 0;
+		}
+	}
+	return name[16] == '.' && known_kind(name + 17);
+}
+
+/* .tmp- and the 6 characters mkstemp fills in */
+static int is_tmp(const char *name)
+{
+	int i;
+
+	if(strncmp(name, ".tmp-", 5) != 0) {
+		return 0;
+	}
+	for(i=5; i<11; i++) {
+		if(!isalnum((unsigned char)name[i])) {
+			return 0;
+		}
+	}
+	return name[11] == 0;
+}
+
+static int cmp_mtime(const void *a, const void *b)
+{
+	const struct entry *ea = a, *eb = b;
+	return ea->mtime < eb->mtime ? -1 : (ea->mtime > eb->mtime ? 1 : 0);
+}
+
+/* recount the cache, deleting stale temporary files, and drop least recently
+ * used entries until it fits in its max_size
+ */
+static void evict(struct cache *cache)
+{
+	int i, num = 0, max_num = 0;
+	DIR *dir;
+	struct dirent *dent;
+	struct entry *ents = 0, *tmp;
+	struct stat st;
+	size_t total = 0;
+	char path[1024];
+	time_t now = time(0);
+
+	if(!(dir = opendir(cache->dir))) {
+		return;
+	}
+
+	while((dent = readdir(dir))) {
+		if(!is_entry(dent->d_name) && !is_tmp(dent->d_name)) {
+			continue;
+		}
+
+		snprintf(path, sizeof path, "%s/%s", cache->dir, dent->d_name);
+		if(lstat(path, &st) == -1 || !S_ISREG(st.st_mode)) {
+			continue;
+		}
+		if(dent->d_name[0] == '.') {
+			/* could still be in the middle of being written by someone */
+			if(now - st.st_mtime > TMP_MAX_AGE) {
+				unlink(path);
+			}
+			continue;
+		}
+
+		if(num >= max_num) {
+			max_num = max_num ? max_num * 2 : 64;
+			if(!(tmp = realloc(ents, max_num * sizeof *ents))) {
+				break;
+			}
+			ents = tmp;
+		}
+		if(!(ents[num].name = malloc(strlen(dent->d_name) + 1))) {
+			break;
+		}
+		strcpy(ents[num].name, dent->d_name);
+		ents[num].size = st.st_size;
+		ents[num].mtime = st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+		total += st.st_size;
+		num++;
+	}
+	closedir(dir);
+
+	if(cache->max_size && total > cache->max_size) {
+		qsort(ents, num, sizeof *ents, cmp_mtime);
+
+		for(i=0; i<num && total > cache->max_size; i++) {
+			snprintf(path, sizeof path, "%s/%s", cache->dir, ents[i].name);
+			if(unlink(path) == 0) {
+				total -= ents[i].size;
+			}
+		}
+	}
+
+	cache->cur_size = total;
+
+	for(i=0; i<num; i++) {
+		free(ents[i].name);
+	}
+	free(ents);
+}
@@ -0,0 +1,34 @@
+#ifndef CACHE_H_
+#define CACHE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Content-addressed on-disk cache. Entries are files named by a 64bit key
+ * and a kind suffix ("tc" or "ver"), written atomically (temp file + rename)
+ * and mapped read-only on a hit. The least recently used entries are evicted
+ * whenever the directory grows past its size cap. Files the cache didn't
+ * name itself are neither counted nor evicted.
+ */
+
+struct cache;
+
+/* open (creating it if necessary) the cache directory dir, capping its
+ * size at max_bytes. Returns 0 on failure.
+ */
+struct cache *cache_open(const char *dir, size_t max_bytes);
+void cache_close(struct cache *cache);
+
+/* fast 64bit hash (XXH64) of data, chained through seed */
+uint64_t cache_hash(const void *data, size_t size, uint64_t seed);
+
+/* map the entry (key, kind) read-only. Returns 0 on a miss, or if cache
+ * is null.
+ */
+void *cache_map(struct cache *cache, uint64_t key, const char *kind, size_t *size);
+void cache_unmap(void *data, size_t size);
+
+int cache_store(struct cache *cache, uint64_t key, const char *kind, const void *data,
+		size_t size);
+
+#endif	/* CACHE_H_ */
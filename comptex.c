@@ -0,0 +1,312 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include "comptex.h"
+#include "texture.h"
+#include "transcode.h"
+#include "cache.h"
+#include "import.h"
+#include "swizzle.h"
+
+struct comptex_file {
+	struct import_info inf;
+	unsigned int srcfmt;
+	unsigned char *map;
+	size_t mapsize;
+
+	/* comptex_load: the levels are in ct instead of the mapping */
+	int loaded;
+	struct comptex ct;
+};
+
+struct comptex_ctx *comptex_create(void)
+{
+	struct comptex_ctx *ctx;
+
+	if(!(ctx = calloc(1, sizeof *ctx))) {
+		fprintf(stderr, "failed to allocate loader context\n");
+		return 0;
+	}
+	return ctx;
+}
+
+void comptex_destroy(struct comptex_ctx *ctx)
+{
+	if(!ctx) return;
+
+	cache_close(ctx->cache);
+	free(ctx->fmt);
+	free(ctx);
+}
+
+static int cmp_int(const void *a, const void *b)
+{
+	return *(const int*)a - *(const int*)b;
+}
+
+int comptex_set_formats(struct comptex_ctx *ctx, const int *fmt, int num_fmt)
+{
+	int *fmtlist = 0;
+
+	if(num_fmt > 0) {
+		if(!(fmtlist = malloc(num_fmt * sizeof *fmtlist))) {
+			fprintf(stderr, "failed to allocate texture format list\n");
+			return -1;
+		}
+		memcpy(fmtlist, fmt, num_fmt * sizeof *fmtlist);
+		/* sorted, so that the fingerprint doesn't depend on the driver's order */
+		qsort(fmtlist, num_fmt, sizeof *fmtlist, cmp_int);
+	} else {
+		num_fmt = 0;
+	}
+	free(ctx->fmt);
+	ctx->fmt = fmtlist;
+	ctx->num_fmt = num_fmt;
+
+	ctx->fmt_fingerprint = num_fmt ? cache_hash(fmtlist, num_fmt * sizeof *fmtlist, 0) : 0;
+	ctx->drv_fingerprint = cache_hash(&ctx->drv_hash, sizeof ctx->drv_hash, ctx->fmt_fingerprint);
+	return 0;
+}
+
+void comptex_set_driver(struct comptex_ctx *ctx, const char *renderer, const char *version)
+{
+	ctx->drv_hash = 0;
+	if(renderer) {
+		ctx->drv_hash = cache_hash(renderer, strlen(renderer), ctx->drv_hash);
+	}
+	if(version) {
+		ctx->drv_hash = cache_hash(version, strlen(version), ctx->drv_hash);
+	}
+	ctx->drv_fingerprint = cache_hash(&ctx->drv_hash, sizeof ctx->drv_hash, ctx->fmt_fingerprint);
+}
+
+int comptex_set_cache(struct comptex_ctx *ctx, const char *dir, size_t max_bytes)
+{
+	struct cache *cache = 0;
+
+	if(dir && !(cache = cache_open(dir, max_bytes))) {
+		return -1;
+	}
+	cache_close(ctx->cache);
+	ctx->cache = cache;
+	return 0;
+}
+
+struct comptex_file *comptex_open(const char *fname)
+{
+	int i;
+	FILE *fp;
+	struct stat st;
+	struct comptex_file *cf;
+
+	if(!(cf = calloc(1, sizeof *cf))) {
+		fprintf(stderr, "failed to allocate texture file\n");
+		return 0;
+	}
+	if(!(fp = fopen(fname, "rb"))) {
+		fprintf(stderr, "failed to open file: %s: %s\n", fname, strerror(errno));
+		free(cf);
+		return 0;
+	}
+	if(import_open(fname, fp, &cf->inf) == -1) {
+		goto err;
+	}
+	if(fstat(fileno(fp), &st) == -1) {
+		fprintf(stderr, "failed to stat %s: %s\n", fname, strerror(errno));
+		goto err;
+	}
+	/* the levels are read straight out of the mapping, make sure each one is
+	 * in the file and as big as its dimensions say
+	 */
+	for(i=0; i<cf->inf.levels; i++) {
+		if(cf->inf.offset[i] < 0 || cf->inf.size[i] > st.st_size ||
+				cf->inf.offset[i] > st.st_size - cf->inf.size[i]) {
+			fprintf(stderr, "unexpected EOF while reading texture: %s\n", fname);
+			goto err;
+		}
+		if(check_level_size(fname, cf->inf.glfmt, cf->inf.width, cf->inf.height, i,
+					cf->inf.size[i]) == -1) {
+			goto err;
+		}
+	}
+
+	cf->srcfmt = cf->inf.glfmt;
+	cf->mapsize = st.st_size;
+	if((cf->map = mmap(0, cf->mapsize, PROT_READ, MAP_PRIVATE, fileno(fp), 0)) == MAP_FAILED) {
+		fprintf(stderr, "failed to map %s: %s\n", fname, strerror(errno));
+		goto err;
+	}
+	fclose(fp);
+	return cf;
+
+err:
+	fclose(fp);
+	free(cf);
+	return 0;
+}
+
+struct comptex_file *comptex_load(struct comptex_ctx *ctx, const char *fname)
+{
+	int i;
+	FILE *fp;
+	size_t rd;
+	struct comptex_header hdr;
+	struct comptex_file *cf;
+
+	if(!(cf = calloc(1, sizeof *cf))) {
+		fprintf(stderr, "failed to allocate texture file\n");
+		return 0;
+	}
+	if(!(fp = fopen(fname, "rb"))) {
+		fprintf(stderr, "failed to open file: %s: %s\n", fname, strerror(errno));
+		free(cf);
+		return 0;
+	}
+	rd = fread(&hdr, 1, sizeof hdr, fp);
+	fclose(fp);
+
+	if(read_comptex(ctx, fname, &cf->ct) == -1) {
+		free(cf);
+		return 0;
+	}
+	cf->loaded = 1;
+	cf->srcfmt = cf->ct.srcfmt;
+	cf->inf.type = import_probe(&hdr, rd);
+	cf->inf.glfmt = cf->ct.fmt;
+	cf->inf.width = cf->ct.width;
+	cf->inf.height = cf->ct.height;
+	cf->inf.levels = cf->ct.levels;
+	cf->inf.layout = cf->ct.layout;
+	for(i=0; i<cf->ct.levels; i++) {
+		cf->inf.size[i] = cf->ct.size[i];
+	}
+	return cf;
+}
+
+void comptex_close(struct comptex_file *cf)
+{
+	if(!cf) return;
+
+	if(cf->loaded) {
+		free_comptex(&cf->ct);
+	} else {
+		munmap(cf->map, cf->mapsize);
+	}
+	free(cf);
+}
+
+void comptex_get_info(const struct comptex_file *cf, struct comptex_info *info)
+{
+	info->type = cf->inf.type;
+	info->glfmt = cf->inf.glfmt;
+	info->srcfmt = cf->srcfmt;
+	info->width = cf->inf.width;
+	info->height = cf->inf.height;
+	info->levels = cf->inf.levels;
+	info->layout = cf->inf.layout;
+}
+
+int comptex_get_level(const struct comptex_file *cf, int level, struct comptex_level *lvl)
+{
+	if(level < 0 || level >= cf->inf.levels || !cf->inf.size[level]) {
+		return -1;
+	}
+	lvl->width = cf->inf.width >> level;
+	lvl->height = cf->inf.height >> level;
+	if(lvl->width < 1) lvl->width = 1;
+	if(lvl->height < 1) lvl->height = 1;
+	lvl->size = cf->inf.size[level];
+	lvl->data = cf->loaded ? cf->ct.data[level] : cf->map + cf->inf.offset[level];
+	return 0;
+}
+
+int comptex_format_desc(unsigned int glfmt, struct comptex_format *desc)
+{
+	const char *name = fmtstr(glfmt);
+
+	if(strcmp(name, "unknown") == 0) {
+		return -1;
+	}
+	desc->glfmt = glfmt;
+	desc->name = name;
+	desc->block_size = transcode_block_size(glfmt);
+	desc->compressed = transcode_is_compressed(glfmt);
+	desc->decodable = transcode_can_decode(glfmt);
+	return 0;
+}
+
+int comptex_decode_level(const struct comptex_file *cf, int level, void *rgba, int nthreads)
+{
+	int res;
+	struct comptex_level lvl;
+	unsigned char *lin = 0;
+
+	if(comptex_get_level(cf, level, &lvl) == -1) {
+		return -1;
+	}
+	if(!transcode_can_decode(cf->inf.glfmt)) {
+		fprintf(stderr, "can't decode %s [%x]\n", fmtstr(cf->inf.glfmt), cf->inf.glfmt);
+		return -1;
+	}
+
+	if(cf->inf.layout != LAYOUT_LINEAR) {
+		if(!(lin = malloc(lvl.size))) {
+			fprintf(stderr, "failed to allocate unswizzling buffer (%u bytes)\n", lvl.size);
+			return -1;
+		}
+		unswizzle_level(cf->inf.layout, lvl.data, lin, lvl.width, lvl.height,
+				transcode_block_size(cf->inf.glfmt));
+	}
+	res = transcode(cf->inf.glfmt, lin ? lin : lvl.data, TC_RGBA8, rgba, lvl.width, lvl.height,
+			nthreads);
+	free(lin);
+	return res;
+}
+
+int comptex_verify_level(const struct comptex_file *cf, int level, const void *data, size_t size,
+		long *diff)
+{
+	long offs;
+	struct comptex_level lvl;
+	unsigned char *lin = 0;
+
+	if(comptex_get_level(cf, level, &lvl) == -1) {
+		return -1;
+	}
+	if(size != lvl.size) {
+		fprintf(stderr, "level %d is %u bytes, got %lu to compare\n", level, lvl.size,
+				(unsigned long)size);
+		return -1;
+	}
+
+	if(cf->inf.layout != LAYOUT_LINEAR) {
+		if(!(lin = malloc(lvl.size))) {
+			fprintf(stderr, "failed to allocate unswizzling buffer (%u bytes)\n", lvl.size);
+			return -1;
+		}
+		unswizzle_level(cf->inf.layout, lvl.data, lin, lvl.width, lvl.height,
+				transcode_block_size(cf->inf.glfmt));
+	}
+	offs = comptex_diff(lin ? lin : lvl.data, data, size);
+	free(lin);
+
+	if(diff) *diff = offs;
+	return offs == -1 ? 0 : 1;
+}
+
+long comptex_diff(const void *a, const void *b, size_t size)
+{
+	size_t i;
+	const unsigned char *pa = a, *pb = b;
+
+	if(memcmp(a, b, size) == 0) {
+		return -1;
+	}
+	for(i=0; i<size; i++) {
+		if(pa[i] != pb[i]) break;
+	}
+	return i;
+}
@@ -0,0 +1,117 @@
+#ifndef COMPTEX_H_
+#define COMPTEX_H_
+
+#include <stddef.h>
+
+/* libcomptex file API: texture files mapped into memory and read in place.
+ * Every call works on its own handle and nothing touches GL or any global
+ * state, so different threads can use different files at the same time. The
+ * GL upload layer is in texgl.h.
+ */
+
+/* containers */
+enum {
+	COMPTEX_FILE_UNKNOWN,
+	COMPTEX_FILE_COMPTEX,
+	COMPTEX_FILE_DDS,
+	COMPTEX_FILE_KTX,
+	COMPTEX_FILE_KTX2,
+	COMPTEX_FILE_LEGACY		/* headerless ETC2 level 0 of the old compressed_texture */
+};
+
+/* block orders of the level data. Other than linear, blocks are grouped in
+ * tiles of COMPTEX_TILE_BLOCKS x COMPTEX_TILE_BLOCKS blocks, stored row by
+ * row. The blocks of a tile are stored row by row (tiled), or in Z-order
+ * (morton). Tiles cut short by the edge of the level are always row by row.
+ */
+enum {
+	COMPTEX_ORDER_LINEAR,
+	COMPTEX_ORDER_TILED,
+	COMPTEX_ORDER_MORTON
+};
+#define COMPTEX_TILE_BLOCKS	8
+
+struct comptex_file;
+
+/* loader context: the compressed formats textures get transcoded against,
+ * and the transcode cache. Texture loading (read_comptex and the GL layer)
+ * only uses the state in the context it's given, so threads can load with
+ * separate contexts at the same time.
+ */
+struct comptex_ctx;
+
+struct comptex_info {
+	int type;			/* container, COMPTEX_FILE_* */
+	unsigned int glfmt;
+	unsigned int srcfmt;	/* format in the file, differs from glfmt if transcoded */
+	int width, height;
+	int levels;
+	int layout;			/* block order of the levels, COMPTEX_ORDER_* */
+};
+
+struct comptex_level {
+	int width, height;
+	unsigned int size;
+	const void *data;	/* points into the mapped or loaded file, in its block order */
+};
+
+struct comptex_format {
+	unsigned int glfmt;
+	const char *name;
+	int block_size;		/* bytes per 4x4 block, 0 if not a 4x4 block format */
+	int compressed;
+	int decodable;		/* comptex_decode_level can convert it to RGBA8 */
+};
+
+/* a new context with no compressed formats, which transcodes everything it
+ * can decode to RGBA8, and no cache. Returns 0 on failure.
+ */
+struct comptex_ctx *comptex_create(void);
+void comptex_destroy(struct comptex_ctx *ctx);
+
+/* the compressed GL formats the driver takes, copied into the context */
+int comptex_set_formats(struct comptex_ctx *ctx, const int *fmt, int num_fmt);
+/* identify the driver, to tell apart cached results that depend on it.
+ * Either string can be null.
+ */
+void comptex_set_driver(struct comptex_ctx *ctx, const char *renderer, const char *version);
+/* cache transcoded textures in the directory dir (created if necessary),
+ * capped at max_bytes. A null dir disables the cache.
+ */
+int comptex_set_cache(struct comptex_ctx *ctx, const char *dir, size_t max_bytes);
+
+/* open and map a COMPTEX0, DDS, KTX, KTX2 or legacy texture file */
+struct comptex_file *comptex_open(const char *fname);
+/* read a texture file into memory instead, transcoding it to the best of
+ * the formats in ctx if it's not one of them, and caching the result if ctx
+ * has a cache. Used like an opened file from then on.
+ */
+struct comptex_file *comptex_load(struct comptex_ctx *ctx, const char *fname);
+void comptex_close(struct comptex_file *cf);
+
+void comptex_get_info(const struct comptex_file *cf, struct comptex_info *info);
+
+/* level data without copying, valid until comptex_close. Returns -1 if the
+ * level doesn't exist or is empty.
+ */
+int comptex_get_level(const struct comptex_file *cf, int level, struct comptex_level *lvl);
+
+/* returns -1 for formats the loader knows nothing about */
+int comptex_format_desc(unsigned int glfmt, struct comptex_format *desc);
+
+/* decode a level to width x height RGBA8 pixels in rgba, splitting the work
+ * across nthreads threads (0: one per CPU)
+ */
+int comptex_decode_level(const struct comptex_file *cf, int level, void *rgba, int nthreads);
+
+/* compare data, in linear block order, with a level of the file. Returns 0
+ * if they match, 1 if they don't (with the first differing byte in diff if
+ * it's not null), -1 on failure.
+ */
+int comptex_verify_level(const struct comptex_file *cf, int level, const void *data, size_t size,
+		long *diff);
+
+/* offset of the first differing byte of a and b, -1 if they're the same */
+long comptex_diff(const void *a, const void *b, size_t size);
+
+#endif	/* COMPTEX_H_ */
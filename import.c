@@ -0,0 +1,692 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdint.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include "import.h"
+#include "transcode.h"
+#include "swizzle.h"
+
+#define FOURCC(a, b, c, d) \
+	((uint32_t)(a) | ((uint32_t)(b) << 8) | ((uint32_t)(c) << 16) | ((uint32_t)(d) << 24))
+
+/* DDS */
+#define DDSD_MIPMAPCOUNT	0x20000
+#define DDSD_DEPTH			0x800000
+#define DDSCAPS2_VOLUME		0x200000
+#define DDPF_ALPHAPIXELS	0x1
+#define DDPF_FOURCC			0x4
+#define DDPF_RGB			0x40
+
+struct dds_header {
+	uint32_t size, flags, height, width, pitch, depth, mipcount;
+	uint32_t reserved1[11];
+	struct {
+		uint32_t size, flags, fourcc, bpp;
+		uint32_t rmask, gmask, bmask, amask;
+	} pf;
+	uint32_t caps, caps2, caps3, caps4, reserved2;
+};
+
+struct dds_dx10 {
+	uint32_t dxgi_fmt, dim, misc, array_size, misc2;
+};
+
+/* KTX 1 */
+struct ktx_header {
+	unsigned char id[12];
+	uint32_t endian;
+	uint32_t gltype, gltype_size, glfmt, glintfmt, glbasefmt;
+	uint32_t width, height, depth;
+	uint32_t array_size, faces, levels;
+	uint32_t kvsize;
+};
+
+/* KTX 2 */
+struct ktx2_header {
+	unsigned char id[12];
+	uint32_t vkfmt, type_size;
+	uint32_t width, height, depth;
+	uint32_t layers, faces, levels;
+	uint32_t supercomp;
+	uint32_t dfd_offset, dfd_size;
+	uint32_t kvd_offset, kvd_size;
+	uint64_t sgd_offset, sgd_size;
+};
+
+struct ktx2_level {
+	uint64_t offset, size, uncomp_size;
+};
+
+#define GL_UNSIGNED_BYTE	0x1401
+#define GL_RGBA				0x1908
+
+#define CONV_BUF_SIZE	(256 * 1024)
+
+static const unsigned char ktx_id[] = {0xab, 'K', 'T', 'X', ' ', '1', '1', 0xbb, '\r', '\n', 0x1a, '\n'};
+static const unsigned char ktx2_id[] = {0xab, 'K', 'T', 'X', ' ', '2', '0', 0xbb, '\r', '\n', 0x1a, '\n'};
+
+static int open_comptex(const char *fname, FILE *fp, struct import_info *inf);
+static int open_dds(const char *fname, FILE *fp, struct import_info *inf);
+static int open_ktx(const char *fname, FILE *fp, struct import_info *inf);
+static int open_ktx2(const char *fname, FILE *fp, struct import_info *inf);
+static int open_legacy(const char *fname, FILE *fp, struct import_info *inf);
+static int calc_levels(const char *fname, struct import_info *inf, long offset);
+static int check_size(const char *fname, FILE *fp, const struct import_info *inf);
+static int relayout_level(const struct import_info *inf, int level, int layout, FILE *in, FILE *out,
+		unsigned char *buf, unsigned char *tmp);
+static unsigned int dxgi_glfmt(uint32_t dxgi);
+static unsigned int vk_glfmt(uint32_t vkfmt);
+static uint32_t swap32(uint32_t x);
+
+
+int import_probe(const void *buf, size_t size)
+{
+	if(size >= 8 && memcmp(buf, "COMPTEX0", 8) == 0) {
+		return IMPORT_COMPTEX;
+	}
+	if(size >= 4 && memcmp(buf, "DDS ", 4) == 0) {
+		return IMPORT_DDS;
+	}
+	if(size >= sizeof ktx_id && memcmp(buf, ktx_id, sizeof ktx_id) == 0) {
+		return IMPORT_KTX;
+	}
+	if(size >= sizeof ktx2_id && memcmp(buf, ktx2_id, sizeof ktx2_id) == 0) {
+		return IMPORT_KTX2;
+	}
+	return IMPORT_LEGACY;
+}
+
+const char *import_type_name(int type)
+{
+	switch(type) {
+	case IMPORT_COMPTEX:
+		return "COMPTEX";
+	case IMPORT_DDS:
+		return "DDS";
+	case IMPORT_KTX:
+		return "KTX";
+	case IMPORT_KTX2:
+		return "KTX2";
+	case IMPORT_LEGACY:
+		return "legacy";
+	default:
+		break;
+	}
+	return "unknown";
+}
+
+int import_open(const char *fname, FILE *fp, struct import_info *inf)
+{
+	unsigned char buf[16];
+	size_t n;
+
+	memset(inf, 0, sizeof *inf);
+
+	rewind(fp);
+	n = fread(buf, 1, sizeof buf, fp);
+	rewind(fp);
+
+	switch((inf->type = import_probe(buf, n))) {
+	case IMPORT_COMPTEX:
+		return open_comptex(fname, fp, inf);
+	case IMPORT_DDS:
+		return open_dds(fname, fp, inf);
+	case IMPORT_KTX:
+		return open_ktx(fname, fp, inf);
+	case IMPORT_KTX2:
+		return open_ktx2(fname, fp, inf);
+	default:
+		break;
+	}
+	return open_legacy(fname, fp, inf);
+}
+
+void import_comptex_header(const struct import_info *inf, struct comptex_header *hdr)
+{
+	int i;
+	uint32_t pos = 0;
+
+	memset(hdr, 0, sizeof *hdr);
+	memcpy(hdr->magic, "COMPTEX0", sizeof hdr->magic);
+	hdr->glfmt = inf->glfmt;
+	/* bit 0 is set in all files written by the original tools */
+	hdr->flags = 1 | COMPTEX_LAYOUT_FLAGS(inf->layout);
+	hdr->levels = inf->levels;
+	hdr->width = inf->width;
+	hdr->height = inf->height;
+
+	for(i=0; i<inf->levels; i++) {
+		hdr->datadesc[i].offset = pos;
+		hdr->datadesc[i].size = inf->size[i];
+		pos += inf->size[i];
+	}
+}
+
+int import_read(const char *fname, FILE *fp, const struct import_info *inf, void *buf)
+{
+	int i;
+	unsigned char *ptr = buf;
+
+	for(i=0; i<inf->levels; i++) {
+		if(!inf->size[i]) continue;
+
+		if(fseek(fp, inf->offset[i], SEEK_SET) == -1 || fread(ptr, 1, inf->size[i], fp) != inf->size[i]) {
+			fprintf(stderr, "unexpected EOF while reading texture: %s\n", fname);
+			return -1;
+		}
+		ptr += inf->size[i];
+	}
+	return 0;
+}
+
+int import_convert(const char *infile, const char *outfile, int layout)
+{
+	int i, res;
+	FILE *in, *out;
+	struct import_info inf, outinf;
+	struct comptex_header hdr;
+	unsigned char *buf, *tmp = 0;
+	size_t sz, left;
+
+	if(!(in = fopen(infile, "rb"))) {
+		fprintf(stderr, "failed to open file: %s: %s\n", infile, strerror(errno));
+		return -1;
+	}
+	if(import_open(infile, in, &inf) == -1) {
+		fclose(in);
+		return -1;
+	}
+	if(layout != inf.layout && !transcode_block_size(inf.glfmt)) {
+		fprintf(stderr, "%s: %s block order needs a block-compressed format\n", infile,
+				layout_name(layout));
+		fclose(in);
+		return -1;
+	}
+	posix_fadvise(fileno(in), 0, 0, POSIX_FADV_SEQUENTIAL);
+
+	/* reordering needs a whole level, and level 0 is the largest */
+	sz = layout != inf.layout && inf.size[0] > CONV_BUF_SIZE ? inf.size[0] : CONV_BUF_SIZE;
+	if(!(buf = malloc(sz)) || (layout != inf.layout && !(tmp = malloc(sz)))) {
+		fprintf(stderr, "failed to allocate conversion buffer\n");
+		free(buf);
+		fclose(in);
+		return -1;
+	}
+	if(!(out = fopen(outfile, "wb"))) {
+		fprintf(stderr, "failed to open %s for writing: %s\n", outfile, strerror(errno));
+		free(buf);
+		free(tmp);
+		fclose(in);
+		return -1;
+	}
+
+	outinf = inf;
+	outinf.layout = layout;
+	import_comptex_header(&outinf, &hdr);
+	if(fwrite(&hdr, sizeof hdr, 1, out) != 1) {
+		goto write_err;
+	}
+
+	for(i=0; i<inf.levels; i++) {
+		if(fseek(in, inf.offset[i], SEEK_SET) == -1) {
+			goto read_err;
+		}
+		if(layout != inf.layout) {
+			if((res = relayout_level(&inf, i, layout, in, out, buf, tmp)) == -1) {
+				goto read_err;
+			}
+			if(res == -2) {
+				goto write_err;
+			}
+			continue;
+		}
+
+		left = inf.size[i];
+		while(left > 0) {
+			sz = left < CONV_BUF_SIZE ? left : CONV_BUF_SIZE;
+			if(fread(buf, 1, sz, in) != sz) {
+				goto read_err;
+			}
+			if(fwrite(buf, 1, sz, out) != sz) {
+				goto write_err;
+			}
+			left -= sz;
+		}
+	}
+
+	free(buf);
+	free(tmp);
+	fclose(in);
+	if(fclose(out) == EOF) {
+		fprintf(stderr, "failed to write %s: %s\n", outfile, strerror(errno));
+		remove(outfile);
+		return -1;
+	}
+	return 0;
+
+read_err:
+	fprintf(stderr, "unexpected EOF while reading texture: %s\n", infile);
+	goto err;
+write_err:
+	fprintf(stderr, "failed to write %s: %s\n", outfile, strerror(errno));
+err:
+	free(buf);
+	free(tmp);
+	fclose(in);
+	fclose(out);
+	remove(outfile);
+	return -1;
+}
+
+/* read a level, convert its block order from inf->layout to layout, and
+ * write it out. Returns -1 on read errors, -2 on write errors.
+ */
+static int relayout_level(const struct import_info *inf, int level, int layout, FILE *in, FILE *out,
+		unsigned char *buf, unsigned char *tmp)
+{
+	int width = inf->width >> level;
+	int height = inf->height >> level;
+	int bsize = transcode_block_size(inf->glfmt);
+	unsigned int size = inf->size[level];
+	unsigned char *lin = buf;
+
+	if(width < 1) width = 1;
+	if(height < 1) height = 1;
+
+	if(fread(buf, 1, size, in) != size) {
+		return -1;
+	}
+	if(inf->layout != LAYOUT_LINEAR) {
+		unswizzle_level(inf->layout, buf, tmp, width, height, bsize);
+		lin = tmp;
+	}
+	if(layout != LAYOUT_LINEAR) {
+		swizzle_level(layout, lin, lin == buf ? tmp : buf, width, height, bsize);
+		lin = lin == buf ? tmp : buf;
+	}
+	if(fwrite(lin, 1, size, out) != size) {
+		return -2;
+	}
+	return 0;
+}
+
+static int open_comptex(const char *fname, FILE *fp, struct import_info *inf)
+{
+	int i;
+	struct comptex_header hdr;
+
+	if(fread(&hdr, sizeof hdr, 1, fp) != 1 || hdr.levels > MAX_LEVELS || !hdr.datadesc[0].size) {
+		fprintf(stderr, "%s is not a compressed texture file, or is corrupted\n", fname);
+		return -1;
+	}
+	if((inf->layout = COMPTEX_LAYOUT(hdr.flags)) >= NUM_LAYOUTS ||
+			(inf->layout != LAYOUT_LINEAR && !transcode_block_size(hdr.glfmt))) {
+		fprintf(stderr, "%s: unsupported block layout (flags: %x)\n", fname, (unsigned int)hdr.flags);
+		return -1;
+	}
+	inf->glfmt = hdr.glfmt;
+	inf->width = hdr.width;
+	inf->height = hdr.height;
+	inf->levels = hdr.levels;
+	for(i=0; i<hdr.levels; i++) {
+		inf->offset[i] = sizeof hdr + hdr.datadesc[i].offset;
+		inf->size[i] = hdr.datadesc[i].size;
+	}
+	return check_size(fname, fp, inf);
+}
+
+static int open_dds(const char *fname, FILE *fp, struct import_info *inf)
+{
+	long offset;
+	struct dds_header hdr;
+	struct dds_dx10 dx10;
+
+	if(fseek(fp, 4, SEEK_SET) == -1 || fread(&hdr, sizeof hdr, 1, fp) != 1 || hdr.size != sizeof hdr) {
+		fprintf(stderr, "%s: invalid DDS header\n", fname);
+		return -1;
+	}
+	offset = 4 + sizeof hdr;
+
+	if((hdr.caps2 & DDSCAPS2_VOLUME) || ((hdr.flags & DDSD_DEPTH) && hdr.depth > 1)) {
+		fprintf(stderr, "%s: only 2D DDS textures are supported\n", fname);
+		return -1;
+	}
+
+	if(hdr.pf.flags & DDPF_FOURCC) {
+		switch(hdr.pf.fourcc) {
+		case FOURCC('D', 'X', 'T', '1'):
+			inf->glfmt = hdr.pf.flags & DDPF_ALPHAPIXELS ? TC_RGBA_S3TC_DXT1 : TC_RGB_S3TC_DXT1;
+			break;
+		case FOURCC('D', 'X', 'T', '2'):
+		case FOURCC('D', 'X', 'T', '3'):
+			inf->glfmt = TC_RGBA_S3TC_DXT3;
+			break;
+		case FOURCC('D', 'X', 'T', '4'):
+		case FOURCC('D', 'X', 'T', '5'):
+			inf->glfmt = TC_RGBA_S3TC_DXT5;
+			break;
+		case FOURCC('A', 'T', 'I', '1'):
+		case FOURCC('B', 'C', '4', 'U'):
+			inf->glfmt = TC_RED_RGTC1;
+			break;
+		case FOURCC('B', 'C', '4', 'S'):
+			inf->glfmt = 0x8dbc;	/* signed RGTC1 */
+			break;
+		case FOURCC('A', 'T', 'I', '2'):
+		case FOURCC('B', 'C', '5', 'U'):
+			inf->glfmt = TC_RG_RGTC2;
+			break;
+		case FOURCC('B', 'C', '5', 'S'):
+			inf->glfmt = 0x8dbe;	/* signed RGTC2 */
+			break;
+		case FOURCC('D', 'X', '1', '0'):
+			if(fread(&dx10, sizeof dx10, 1, fp) != 1) {
+				fprintf(stderr, "%s: invalid DDS DX10 header\n", fname);
+				return -1;
+			}
+			if(dx10.dim != 3) {	/* D3D10_RESOURCE_DIMENSION_TEXTURE2D */
+				fprintf(stderr, "%s: only 2D DDS textures are supported\n", fname);
+				return -1;
+			}
+			offset += sizeof dx10;
+			inf->glfmt = dxgi_glfmt(dx10.dxgi_fmt);
+			break;
+		default:
+			break;
+		}
+	} else if((hdr.pf.flags & DDPF_RGB) && hdr.pf.bpp == 32 && hdr.pf.rmask == 0xff &&
+			hdr.pf.gmask == 0xff00 && hdr.pf.bmask == 0xff0000) {
+		inf->glfmt = TC_RGBA8;
+	}
+
+	if(!inf->glfmt) {
+		fprintf(stderr, "%s: unsupported DDS pixel format\n", fname);
+		return -1;
+	}
+
+	inf->width = hdr.width;
+	inf->height = hdr.height;
+	inf->levels = (hdr.flags & DDSD_MIPMAPCOUNT) && hdr.mipcount ? hdr.mipcount : 1;
+
+	/* levels of the first surface follow the header back to back */
+	if(calc_levels(fname, inf, offset) == -1) {
+		return -1;
+	}
+	return check_size(fname, fp, inf);
+}
+
+static int open_ktx(const char *fname, FILE *fp, struct import_info *inf)
+{
+	int i, swap;
+	long pos;
+	uint32_t imgsize, *fld;
+	struct ktx_header hdr;
+
+	if(fread(&hdr, sizeof hdr, 1, fp) != 1) {
+		fprintf(stderr, "%s: invalid KTX header\n", fname);
+		return -1;
+	}
+	/* written on a machine of the opposite byte order */
+	if((swap = hdr.endian == 0x01020304)) {
+		for(fld=&hdr.endian; fld<=&hdr.kvsize; fld++) {
+			*fld = swap32(*fld);
+		}
+	} else if(hdr.endian != 0x04030201) {
+		fprintf(stderr, "%s: invalid KTX header\n", fname);
+		return -1;
+	}
+
+	if(hdr.depth > 1) {
+		fprintf(stderr, "%s: 3D KTX textures are not supported\n", fname);
+		return -1;
+	}
+	if(hdr.gltype && !(hdr.gltype == GL_UNSIGNED_BYTE && hdr.glfmt == GL_RGBA &&
+			(hdr.glintfmt == TC_RGBA8 || hdr.glintfmt == TC_SRGB8_ALPHA8))) {
+		fprintf(stderr, "%s: unsupported uncompressed KTX format %x\n", fname, hdr.glintfmt);
+		return -1;
+	}
+	if((inf->levels = hdr.levels ? hdr.levels : 1) > MAX_LEVELS) {
+		fprintf(stderr, "%s: too many mipmap levels (%d)\n", fname, inf->levels);
+		return -1;
+	}
+	inf->glfmt = hdr.glintfmt;
+	inf->width = hdr.width;
+	inf->height = hdr.height ? hdr.height : 1;
+
+	/* every level is preceded by its size. For non-array cubemaps that's the
+	 * size of one face, otherwise of all array layers or faces together.
+	 */
+	pos = sizeof hdr + hdr.kvsize;
+	for(i=0; i<inf->levels; i++) {
+		if(fseek(fp, pos, SEEK_SET) == -1 || fread(&imgsize, 4, 1, fp) != 1) {
+			fprintf(stderr, "unexpected EOF while reading texture: %s\n", fname);
+			return -1;
+		}
+		if(swap) {
+			imgsize = swap32(imgsize);
+		}
+		inf->offset[i] = pos + 4;
+
+		if(hdr.faces <= 1 && hdr.array_size <= 1) {
+			inf->size[i] = imgsize;
+		} else {
+			inf->size[i] = transcode_level_size(inf->glfmt, inf->width >> i, inf->height >> i);
+			if(!inf->size[i] || inf->size[i] > imgsize) {
+				fprintf(stderr, "%s: can't locate the first layer of format %x\n", fname, inf->glfmt);
+				return -1;
+			}
+		}
+
+		if(hdr.faces == 6 && !hdr.array_size) {
+			pos += 4 + 6 * ((imgsize + 3) & ~3);
+		} else {
+			pos += 4 + ((imgsize + 3) & ~3);
+		}
+	}
+	return check_size(fname, fp, inf);
+}
+
+static int open_ktx2(const char *fname, FILE *fp, struct import_info *inf)
+{
+	int i;
+	struct ktx2_header hdr;
+	struct ktx2_level lvl;
+
+	if(fread(&hdr, sizeof hdr, 1, fp) != 1) {
+		fprintf(stderr, "%s: invalid KTX2 header\n", fname);
+		return -1;
+	}
+	if(hdr.supercomp) {
+		fprintf(stderr, "%s: supercompressed KTX2 files are not supported\n", fname);
+		return -1;
+	}
+	if(hdr.depth > 1) {
+		fprintf(stderr, "%s: 3D KTX2 textures are not supported\n", fname);
+		return -1;
+	}
+	if(!(inf->glfmt = vk_glfmt(hdr.vkfmt))) {
+		fprintf(stderr, "%s: unsupported KTX2 format %u\n", fname, hdr.vkfmt);
+		return -1;
+	}
+	if((inf->levels = hdr.levels ? hdr.levels : 1) > MAX_LEVELS) {
+		fprintf(stderr, "%s: too many mipmap levels (%d)\n", fname, inf->levels);
+		return -1;
+	}
+	inf->width = hdr.width;
+	inf->height = hdr.height ? hdr.height : 1;
+
+	/* the level index follows the header, finest level first */
+	for(i=0; i<inf->levels; i++) {
+		if(fread(&lvl, sizeof lvl, 1, fp) != 1) {
+			fprintf(stderr, "%s: invalid KTX2 level index\n", fname);
+			return -1;
+		}
+		/* 64bit in the file, anything that doesn't fit can't be in it */
+		if(lvl.offset > LONG_MAX || lvl.size > UINT_MAX) {
+			fprintf(stderr, "%s: invalid KTX2 level %d (offset: %llu, size: %llu)\n", fname, i,
+					(unsigned long long)lvl.offset, (unsigned long long)lvl.size);
+			return -1;
+		}
+		inf->offset[i] = lvl.offset;
+
+		if(hdr.faces <= 1 && hdr.layers <= 1) {
+			inf->size[i] = lvl.size;
+		} else {
+			inf->size[i] = transcode_level_size(inf->glfmt, inf->width >> i, inf->height >> i);
+			if(!inf->size[i] || inf->size[i] > lvl.size) {
+				fprintf(stderr, "%s: can't locate the first layer of format %x\n", fname, inf->glfmt);
+				return -1;
+			}
+		}
+	}
+	return check_size(fname, fp, inf);
+}
+
+/* the old compressed_texture file: width and height, followed by level 0 in
+ * ETC2, which has to be either RGB or RGBA going by the size of the data
+ */
+static int open_legacy(const char *fname, FILE *fp, struct import_info *inf)
+{
+	uint32_t dim[2];
+	struct stat st;
+	long datasize;
+
+	if(fread(dim, sizeof dim, 1, fp) != 1 || fstat(fileno(fp), &st) == -1 ||
+			dim[0] < 1 || dim[0] > 65536 || dim[1] < 1 || dim[1] > 65536) {
+		fprintf(stderr, "%s is not a compressed texture file, or is corrupted\n", fname);
+		return -1;
+	}
+	datasize = st.st_size - sizeof dim;
+
+	inf->width = dim[0];
+	inf->height = dim[1];
+	inf->levels = 1;
+	inf->offset[0] = sizeof dim;
+
+	if(datasize == transcode_level_size(TC_RGB8_ETC2, inf->width, inf->height)) {
+		inf->glfmt = TC_RGB8_ETC2;
+	} else if(datasize == transcode_level_size(TC_RGBA8_ETC2_EAC, inf->width, inf->height)) {
+		inf->glfmt = TC_RGBA8_ETC2_EAC;
+	} else {
+		fprintf(stderr, "%s is not a compressed texture file, or is corrupted\n", fname);
+		return -1;
+	}
+	inf->size[0] = datasize;
+	return 0;
+}
+
+/* levels stored back to back starting at offset, sized by the format */
+static int calc_levels(const char *fname, struct import_info *inf, long offset)
+{
+	int i;
+
+	if(inf->levels > MAX_LEVELS) {
+		fprintf(stderr, "%s: too many mipmap levels (%d)\n", fname, inf->levels);
+		return -1;
+	}
+	for(i=0; i<inf->levels; i++) {
+		if(!(inf->size[i] = transcode_level_size(inf->glfmt, inf->width >> i, inf->height >> i))) {
+			fprintf(stderr, "%s: unknown block size for format %x\n", fname, inf->glfmt);
+			return -1;
+		}
+		inf->offset[i] = offset;
+		offset += inf->size[i];
+	}
+	return 0;
+}
+
+static int check_size(const char *fname, FILE *fp, const struct import_info *inf)
+{
+	int i;
+	struct stat st;
+
+	if(inf->width < 1 || inf->height < 1 || !inf->size[0]) {
+		fprintf(stderr, "%s is not a compressed texture file, or is corrupted\n", fname);
+		return -1;
+	}
+	if(fstat(fileno(fp), &st) == -1) {
+		fprintf(stderr, "failed to stat %s: %s\n", fname, strerror(errno));
+		return -1;
+	}
+	for(i=0; i<inf->levels; i++) {
+		if(inf->offset[i] < 0 || inf->size[i] > st.st_size ||
+				inf->offset[i] > st.st_size - inf->size[i]) {
+			fprintf(stderr, "unexpected EOF while reading texture: %s\n", fname);
+			return -1;
+		}
+	}
+	return 0;
+}
+
+static unsigned int dxgi_glfmt(uint32_t dxgi)
+{
+	switch(dxgi) {
+	case 28: return TC_RGBA8;					/* R8G8B8A8_UNORM */
+	case 29: return TC_SRGB8_ALPHA8;			/* R8G8B8A8_UNORM_SRGB */
+	case 71: return TC_RGBA_S3TC_DXT1;			/* BC1_UNORM */
+	case 72: return TC_SRGB_ALPHA_S3TC_DXT1;	/* BC1_UNORM_SRGB */
+	case 74: return TC_RGBA_S3TC_DXT3;			/* BC2_UNORM */
+	case 75: return TC_SRGB_ALPHA_S3TC_DXT3;	/* BC2_UNORM_SRGB */
+	case 77: return TC_RGBA_S3TC_DXT5;			/* BC3_UNORM */
+	case 78: return TC_SRGB_ALPHA_S3TC_DXT5;	/* BC3_UNORM_SRGB */
+	case 80: return TC_RED_RGTC1;				/* BC4_UNORM */
+	case 81: return 0x8dbc;						/* BC4_SNORM */
+	case 83: return TC_RG_RGTC2;				/* BC5_UNORM */
+	case 84: return 0x8dbe;						/* BC5_SNORM */
+	case 95: return 0x8e8f;						/* BC6H_UF16 */
+	case 96: return 0x8e8e;						/* BC6H_SF16 */
+	case 98: return 0x8e8c;						/* BC7_UNORM */
+	case 99: return 0x8e8d;						/* BC7_UNORM_SRGB */
+	default:
+		break;
+	}
+	return 0;
+}
+
+static unsigned int vk_glfmt(uint32_t vkfmt)
+{
+	switch(vkfmt) {
+	case 37: return TC_RGBA8;					/* R8G8B8A8_UNORM */
+	case 43: return TC_SRGB8_ALPHA8;			/* R8G8B8A8_SRGB */
+	case 131: return TC_RGB_S3TC_DXT1;			/* BC1_RGB_UNORM_BLOCK */
+	case 132: return TC_SRGB_S3TC_DXT1;
+	case 133: return TC_RGBA_S3TC_DXT1;			/* BC1_RGBA_UNORM_BLOCK */
+	case 134: return TC_SRGB_ALPHA_S3TC_DXT1;
+	case 135: return TC_RGBA_S3TC_DXT3;			/* BC2 */
+	case 136: return TC_SRGB_ALPHA_S3TC_DXT3;
+	case 137: return TC_RGBA_S3TC_DXT5;			/* BC3 */
+	case 138: return TC_SRGB_ALPHA_S3TC_DXT5;
+	case 139: return TC_RED_RGTC1;				/* BC4 */
+	case 140: return 0x8dbc;
+	case 141: return TC_RG_RGTC2;				/* BC5 */
+	case 142: return 0x8dbe;
+	case 143: return 0x8e8f;					/* BC6H */
+	case 144: return 0x8e8e;
+	case 145: return 0x8e8c;					/* BC7 */
+	case 146: return 0x8e8d;
+	case 147: return TC_RGB8_ETC2;				/* ETC2_R8G8B8_UNORM_BLOCK */
+	case 148: return TC_SRGB8_ETC2;
+	case 149: return TC_RGB8_PUNCHTHROUGH_ETC2;	/* ETC2_R8G8B8A1 */
+	case 150: return TC_SRGB8_PUNCHTHROUGH_ETC2;
+	case 151: return TC_RGBA8_ETC2_EAC;			/* ETC2_R8G8B8A8 */
+	case 152: return TC_SRGB8_ALPHA8_ETC2_EAC;
+	case 153: return TC_R11_EAC;				/* EAC_R11_UNORM_BLOCK */
+	case 154: return 0x9271;
+	case 155: return TC_RG11_EAC;				/* EAC_R11G11_UNORM_BLOCK */
+	case 156: return 0x9273;
+	case 157: return 0x93b0;					/* ASTC_4x4_UNORM_BLOCK */
+	case 158: return 0x93d0;
+	default:
+		break;
+	}
+	return 0;
+}
+
+static uint32_t swap32(uint32_t x)
+{
+	return (x >> 24) | ((x >> 8) & 0xff00) | ((x << 8) & 0xff0000) | (x << 24);
+}
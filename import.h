@@ -0,0 +1,56 @@
+#ifndef IMPORT_H_
+#define IMPORT_H_
+
+#include <stdio.h>
+#include "texture.h"
+#include "comptex.h"
+
+/* readers for the texture containers other tools produce: DDS (including the
+ * DX10 extended header), KTX 1 and 2, and the headerless layout of the old
+ * compressed_texture file (width and height followed by ETC2 level 0).
+ */
+
+enum {
+	IMPORT_UNKNOWN = COMPTEX_FILE_UNKNOWN,
+	IMPORT_COMPTEX = COMPTEX_FILE_COMPTEX,
+	IMPORT_DDS = COMPTEX_FILE_DDS,
+	IMPORT_KTX = COMPTEX_FILE_KTX,
+	IMPORT_KTX2 = COMPTEX_FILE_KTX2,
+	IMPORT_LEGACY = COMPTEX_FILE_LEGACY
+};
+
+/* where the levels of a texture are in its file */
+struct import_info {
+	int type;
+	unsigned int glfmt;
+	int width, height;
+	int levels;
+	int layout;		/* block order, only COMPTEX0 files can have other than linear */
+	long offset[MAX_LEVELS];
+	unsigned int size[MAX_LEVELS];
+};
+
+/* guess the container from the first bytes of a file. Anything unrecognized
+ * is assumed to be the legacy layout, import_open validates it.
+ */
+int import_probe(const void *buf, size_t size);
+const char *import_type_name(int type);
+
+/* parse the container header of fp and locate the levels. Only the first
+ * face or array layer of cubemaps and arrays is used.
+ */
+int import_open(const char *fname, FILE *fp, struct import_info *inf);
+
+/* COMPTEX0 header describing the levels of inf packed one after the other */
+void import_comptex_header(const struct import_info *inf, struct comptex_header *hdr);
+
+/* read the levels of inf into buf, packed one after the other */
+int import_read(const char *fname, FILE *fp, const struct import_info *inf, void *buf);
+
+/* convert a texture file to COMPTEX0, streaming the levels through a small
+ * buffer instead of loading the whole file. If the block order has to change
+ * (layout is one of LAYOUT_* in swizzle.h), one level at a time is loaded.
+ */
+int import_convert(const char *infile, const char *outfile, int layout);
+
+#endif	/* IMPORT_H_ */
@@ -3,15 +3,27 @@
 #include <string.h>
 #include <errno.h>
 #include <assert.h>
+#include <stdint.h>
+#include <sys/stat.h>
+#include <sys/time.h>
 #include <GL/glew.h>
 #include <GL/freeglut.h>
-
-struct texture {
-	unsigned int id;
-	int width, height;
-	unsigned int fmt;
-	unsigned int compsize;
-	void *data;
+#include "texture.h"
+#include "texgl.h"
+#include "texman.h"
+#include "transcode.h"
+#include "cache.h"
+#include "aio.h"
+#include "import.h"
+#include "view.h"
+#include "bench.h"
+#include "swizzle.h"
+#include "perfcheck.h"
+
+/* cached result of comparing submitted and retrieved data */
+struct verdict {
+	char magic[8];
+	int32_t diff_offset;	/* -1 if they matched */
 };
 
 int init(void);
@@ -19,19 +31,60 @@ void disp(void);
 void reshape(int x, int y);
 void keyb(unsigned char key, int x, int y);
 void idle(void);
-int load_texture(const char *fname, struct texture *tex);
-const char *fmtstr(int fmt);
-void print_compressed_formats(void);
+int run_iobench(void);
+int run_bench(void);
+int run_regiontest(void);
+int run_cachetest(const char *dir);
+int region_test(const unsigned char *lin, int width, int height, int bsize);
+int check_region(const void *gpu, int x, int y, int w, int h);
+int convert(const char *outpath);
+void iobench_upload(int idx, struct comptex *ct, void *cls);
+
+/* loader context, with the driver's formats and the cache */
+struct comptex_ctx *ctx;
 
 struct texture tex;
 unsigned int tex2;
 const char *texfile;
+const char **texfiles;
+int num_texfiles;
 int subtest, copytest;
 
+/* soak test: cycle through all texfiles under the texture manager */
+int soak;
+struct managed_tex **soak_tex;
+unsigned long frame;
+
+/* I/O benchmark: batch load all texfiles with each async I/O backend */
+int iobench;
+int io_backend = AIO_ANY;
+
+/* draw the mip chain this many times per frame, to measure sampling cost */
+int instances = 1;
+
+/* sampling benchmark of all texfiles, in offscreen passes of this size */
+int bench;
+int bench_size = 2048;
+
+/* block order of converted files */
+int layout = LAYOUT_LINEAR;
+
+/* CPU swizzling and region extraction benchmark of all texfiles */
+int regiontest;
+
+/* performance regression check, corpus and baseline in this directory */
+const char *perfdir;
+int perf_update;
+
 int main(int argc, char **argv)
 {
 	int i, loop = 0;
 	unsigned int glut_flags = GLUT_RGB | GLUT_DOUBLE;
+	const char *cachedir = 0;
+	int cache_mb = 512;
+	int host_budget_mb = 512, gpu_budget_mb = 256;
+	const char *convpath = 0;
+	const char *cachetest = 0;
 
 	for(i=1; i<argc; i++) {
 		if(argv[i][0] == '-') {
@@ -42,24 +95,133 @@ int main(int argc, char **argv)
 			} else if(strcmp(argv[i], "-copytest-loop") == 0) {
 				copytest = 1;
 				loop = 1;
+			} else if(strcmp(argv[i], "-cache") == 0) {
+				if(!argv[++i]) {
+					fprintf(stderr, "-cache must be followed by a directory\n");
+					return 1;
+				}
+				cachedir = argv[i];
+			} else if(strcmp(argv[i], "-cache-size") == 0) {
+				if(!argv[++i] || (cache_mb = atoi(argv[i])) <= 0) {
+					fprintf(stderr, "-cache-size must be followed by a size in megabytes\n");
+					return 1;
+				}
+			} else if(strcmp(argv[i], "-soak") == 0) {
+				soak = 1;
+				loop = 1;
+			} else if(strcmp(argv[i], "-host-budget") == 0) {
+				if(!argv[++i] || (host_budget_mb = atoi(argv[i])) <= 0) {
+					fprintf(stderr, "-host-budget must be followed by a size in megabytes\n");
+					return 1;
+				}
+			} else if(strcmp(argv[i], "-gpu-budget") == 0) {
+				if(!argv[++i] || (gpu_budget_mb = atoi(argv[i])) <= 0) {
+					fprintf(stderr, "-gpu-budget must be followed by a size in megabytes\n");
+					return 1;
+				}
+			} else if(strcmp(argv[i], "-convert") == 0) {
+				if(!argv[++i]) {
+					fprintf(stderr, "-convert must be followed by an output file or directory\n");
+					return 1;
+				}
+				convpath = argv[i];
+			} else if(strcmp(argv[i], "-layout") == 0) {
+				if(!argv[++i]) {
+					fprintf(stderr, "-layout must be followed by linear, tiled or morton\n");
+					return 1;
+				}
+				if((layout = layout_from_name(argv[i])) == -1) {
+					fprintf(stderr, "invalid block layout: %s\n", argv[i]);
+					return 1;
+				}
+			} else if(strcmp(argv[i], "-instances") == 0) {
+				if(!argv[++i] || (instances = atoi(argv[i])) <= 0) {
+					fprintf(stderr, "-instances must be followed by a number\n");
+					return 1;
+				}
+				loop = 1;
+			} else if(strcmp(argv[i], "-bench") == 0) {
+				bench = 1;
+			} else if(strcmp(argv[i], "-bench-size") == 0) {
+				if(!argv[++i] || (bench_size = atoi(argv[i])) <= 0) {
+					fprintf(stderr, "-bench-size must be followed by a size in pixels\n");
+					return 1;
+				}
+			} else if(strcmp(argv[i], "-regiontest") == 0) {
+				regiontest = 1;
+			} else if(strcmp(argv[i], "-cachetest") == 0) {
+				if(!argv[++i]) {
+					fprintf(stderr, "-cachetest must be followed by a directory\n");
+					return 1;
+				}
+				cachetest = argv[i];
+			} else if(strcmp(argv[i], "-perfcheck") == 0) {
+				if(!argv[++i]) {
+					fprintf(stderr, "-perfcheck must be followed by a directory\n");
+					return 1;
+				}
+				perfdir = argv[i];
+			} else if(strcmp(argv[i], "-perfcheck-update") == 0) {
+				perf_update = 1;
+			} else if(strcmp(argv[i], "-iobench") == 0) {
+				iobench = 1;
+			} else if(strcmp(argv[i], "-io") == 0) {
+				if(!argv[++i]) {
+					fprintf(stderr, "-io must be followed by uring or threads\n");
+					return 1;
+				}
+				if(strcmp(argv[i], "uring") == 0) {
+					io_backend = AIO_URING;
+				} else if(strcmp(argv[i], "threads") == 0) {
+					io_backend = AIO_THREADS;
+				} else {
+					fprintf(stderr, "invalid I/O backend: %s\n", argv[i]);
+					return 1;
+				}
 			} else {
 				fprintf(stderr, "invalid option: %s\n", argv[i]);
 				return 1;
 			}
 		} else {
-			if(texfile) {
-				fprintf(stderr, "unexpected argument: %s\n", argv[i]);
+			if(!texfiles && !(texfiles = malloc(argc * sizeof *texfiles))) {
+				fprintf(stderr, "failed to allocate file list\n");
 				return 1;
 			}
-			texfile = argv[i];
+			texfiles[num_texfiles++] = argv[i];
 		}
 	}
 
-	if(!texfile) {
+	if(cachetest) {
+		return run_cachetest(cachetest) == -1 ? 1 : 0;
+	}
+
+	if(num_texfiles > 1 && !soak && !iobench && !bench && !regiontest && !convpath) {
+		fprintf(stderr, "unexpected argument: %s\n", texfiles[1]);
+		return 1;
+	}
+	if(num_texfiles) {
+		texfile = texfiles[0];
+	}
+
+	if(!texfile && !perfdir) {
 		fprintf(stderr, "you must specify a compressed texture file\n");
 		return 1;
 	}
 
+	if(convpath) {
+		return convert(convpath) == -1 ? 1 : 0;
+	}
+
+	if(!(ctx = comptex_create())) {
+		return 1;
+	}
+	if(cachedir && comptex_set_cache(ctx, cachedir, (size_t)cache_mb << 20) == -1) {
+		return 1;
+	}
+	if(soak) {
+		texman_init(ctx, (size_t)host_budget_mb << 20, (size_t)gpu_budget_mb << 20);
+	}
+
 	glutInit(&argc, argv);
 	glutInitDisplayMode(glut_flags);
 	glutCreateWindow("test");
@@ -76,6 +238,18 @@ int main(int argc, char **argv)
 	if(init() == -1) {
 		return 1;
 	}
+	if(iobench) {
+		return run_iobench() == -1 ? 1 : 0;
+	}
+	if(bench) {
+		return run_bench() == -1 ? 1 : 0;
+	}
+	if(regiontest) {
+		return run_regiontest() == -1 ? 1 : 0;
+	}
+	if(perfdir) {
+		return perfcheck(ctx, perfdir, perf_update) == -1 ? 1 : 0;
+	}
 
 	glutMainLoop();
 	return 0;
@@ -83,17 +257,46 @@ int main(int argc, char **argv)
 
 int init(void)
 {
+	int i;
 	unsigned char *buf;
 	int is_comp = 0;
 	int tmp;
 	unsigned int intfmt;
+	struct verdict *ver = 0, newver;
+	size_t versize;
+	uint64_t verkey = 0;
+
+	print_compressed_formats(ctx);
+	calc_fingerprints(ctx);
 
-	print_compressed_formats();
+	if(iobench || bench || regiontest || perfdir) {
+		return 0;
+	}
+
+	if(view_init(instances > 1) == -1) {
+		return -1;
+	}
 
-	if(load_texture(texfile, &tex) == -1) {
+	if(soak) {
+		if(!(soak_tex = malloc(num_texfiles * sizeof *soak_tex))) {
+			fprintf(stderr, "failed to allocate soak test texture list\n");
+			return -1;
+		}
+		for(i=0; i<num_texfiles; i++) {
+			if(!(soak_tex[i] = texman_add(texfiles[i]))) {
+				return -1;
+			}
+		}
+		printf("soak test: cycling through %d textures\n", num_texfiles);
+		glEnable(GL_TEXTURE_2D);
+		return 0;
+	}
+
+	if(load_texture(ctx, texfile, &tex) == -1) {
 		fprintf(stderr, "failed to load texture %s\n", texfile);
 		return -1;
 	}
+	glutReshapeWindow(tex.width + tex.width / 2, tex.height);
 
 	glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT, (int*)&intfmt);
 	if(intfmt != tex.fmt) {
@@ -101,40 +304,85 @@ int init(void)
 				fmtstr(tex.fmt), tex.fmt, fmtstr(intfmt), intfmt);
 		return -1;
 	}
-	glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_COMPRESSED, &is_comp);
-	if(!is_comp) {
-		fprintf(stderr, "texture is not compressed\n");
-		return -1;
-	}
-	glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &tmp);
-	if(tmp != tex.compsize) {
-		fprintf(stderr, "internal compressed size differs (expected: %d, got: %d)!\n", tex.compsize, tmp);
-		return -1;
+	/* a texture transcoded to an uncompressed fallback format is only
+	 * checked for matching pixel data
+	 */
+	if(transcode_is_compressed(tex.fmt)) {
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_COMPRESSED, &is_comp);
+		if(!is_comp) {
+			fprintf(stderr, "texture is not compressed\n");
+			return -1;
+		}
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &tmp);
+		if(tmp != tex.compsize) {
+			fprintf(stderr, "internal compressed size differs (expected: %d, got: %d)!\n", tex.compsize, tmp);
+			return -1;
+		}
 	}
 
 	if(!(buf = malloc(tex.compsize))) {
 		fprintf(stderr, "failed to allocate comparison image buffer (%d bytes)\n", tex.compsize);
 		return -1;
 	}
-	glGetCompressedTexImage(GL_TEXTURE_2D, 0, buf);
-
-	if(memcmp(tex.data, buf, tex.compsize) != 0) {
-		int i;
-		unsigned char *a = tex.data, *b = buf;
+	/* the readback comparison only depends on the file and the driver, so
+	 * a verdict from a previous run can be reused
+	 */
+	if(tex.hash) {
+		verkey = cache_hash(&ctx->drv_fingerprint, sizeof ctx->drv_fingerprint, tex.hash);
+		if((ver = cache_map(ctx->cache, verkey, "ver", &versize))) {
+			if(versize < sizeof *ver || memcmp(ver->magic, "COMPVER0", 8) != 0) {
+				cache_unmap(ver, versize);
+				ver = 0;
+			}
+		}
+	}
 
-		for(i=0; i<tex.compsize; i++) {
-			if(*a++ != *b++) break;
+	if(ver) {
+		if(ver->diff_offset >= 0) {
+			fprintf(stderr, "submitted and retrieved pixel data differ! (at offset %d, cached)\n",
+					(int)ver->diff_offset);
+		} else {
+			printf("submitted and retrieved sizes match (%d bytes, cached)\n", tex.compsize);
 		}
-		assert(i < tex.compsize);
-		fprintf(stderr, "submitted and retrieved pixel data differ! (at offset %d)\n", i);
+		cache_unmap(ver, versize);
 	} else {
-		printf("submitted and retrieved sizes match (%d bytes)\n", tex.compsize);
+		if(is_comp) {
+			glGetCompressedTexImage(GL_TEXTURE_2D, 0, buf);
+		} else {
+			glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, buf);
+		}
+
+		if((newver.diff_offset = comptex_diff(tex.data, buf, tex.compsize)) >= 0) {
+			fprintf(stderr, "submitted and retrieved pixel data differ! (at offset %d)\n",
+					(int)newver.diff_offset);
+		} else {
+			printf("submitted and retrieved sizes match (%d bytes)\n", tex.compsize);
+		}
+
+		if(tex.hash) {
+			memcpy(newver.magic, "COMPVER0", 8);
+			cache_store(ctx->cache, verkey, "ver", &newver, sizeof newver);
+		}
+	}
+
+	if((subtest || copytest) && !is_comp) {
+		printf("texture was transcoded to %s, skipping compressed sub-image tests\n", fmtstr(tex.fmt));
+		subtest = copytest = 0;
+	}
+	/* the sub-image test reads back the 64x64 region at 192,64 */
+	if(subtest && (tex.width < 256 || tex.height < 128)) {
+		printf("texture is smaller than 256x128, skipping the compressed sub-image test\n");
+		subtest = 0;
 	}
 
 	if(subtest) {
 		printf("testing glGetCompressedTextureSubImage and glCompressedTexSubImage2D\n");
 		memset(buf, 0, tex.compsize);
 		glGetCompressedTextureSubImage(tex.id, 0, 192, 64, 0, 64, 64, 1, tex.compsize, buf);
+		if(check_region(buf, 192, 64, 64, 64) == -1) {
+			free(buf);
+			return -1;
+		}
 		glCompressedTexSubImage2D(GL_TEXTURE_2D, 0, 32, 32, 64, 64, tex.fmt, 2048, buf);
 	}
 
@@ -160,57 +408,365 @@ int init(void)
 	return 0;
 }
 
+/* convert texfiles to COMPTEX0. With more than one input, or when outpath
+ * is a directory, each one is written in outpath as <name>.tex
+ */
+int convert(const char *outpath)
+{
+	int i, res = 0;
+	struct stat st;
+	char *fname;
+	const char *base, *suffix;
+	int is_dir = stat(outpath, &st) == 0 && S_ISDIR(st.st_mode);
+
+	if(num_texfiles > 1 && !is_dir) {
+		fprintf(stderr, "converting multiple files needs an output directory\n");
+		return -1;
+	}
+
+	for(i=0; i<num_texfiles; i++) {
+		if(is_dir) {
+			base = (base = strrchr(texfiles[i], '/')) ? base + 1 : texfiles[i];
+			if(!(suffix = strrchr(base, '.'))) {
+				suffix = base + strlen(base);
+			}
+			if(!(fname = malloc(strlen(outpath) + (suffix - base) + 6))) {
+				fprintf(stderr, "failed to allocate output file name\n");
+				return -1;
+			}
+			sprintf(fname, "%s/%.*s.tex", outpath, (int)(suffix - base), base);
+		} else {
+			fname = (char*)outpath;
+		}
+
+		if(import_convert(texfiles[i], fname, layout) == -1) {
+			res = -1;
+		} else {
+			printf("%s -> %s\n", texfiles[i], fname);
+		}
+
+		if(fname != outpath) {
+			free(fname);
+		}
+	}
+	return res;
+}
+
+/* load all texfiles through read_comptex_batch, uploading each texture as
+ * soon as its data is in, once per backend (or just the one picked with -io)
+ */
+int run_iobench(void)
+{
+	int i, res = 0;
+	double mb;
+	struct batch_stats bst;
+	static const int backends[] = {AIO_URING, AIO_THREADS};
+
+	for(i=0; i<2; i++) {
+		if(io_backend != AIO_ANY && backends[i] != io_backend) {
+			continue;
+		}
+		if(read_comptex_batch(ctx, texfiles, num_texfiles, backends[i], iobench_upload, 0,
+					&bst) == -1) {
+			if(!bst.backend) continue;	/* backend not available */
+			res = -1;
+		}
+		glFinish();
+
+		mb = bst.bytes / 1048576.0;
+		printf("%s: %d files (%d failed), %lu reads, %.2f MB in %.3f ms: %.2f GB/s, %.0f IOPS\n",
+				aio_backend_name(bst.backend), bst.files, bst.failed, bst.reads, mb, bst.msec,
+				bst.msec > 0.0 ? bst.bytes / bst.msec / 1e6 : 0.0,
+				bst.msec > 0.0 ? bst.reads * 1000.0 / bst.msec : 0.0);
+		printf("  %.3f ms of that spent uploading\n", bst.cb_msec);
+	}
+	return res;
+}
+
+int run_bench(void)
+{
+	int i, res = 0;
+	unsigned int id;
+	struct comptex ct;
+
+	if(bench_init(bench_size) == -1) {
+		return -1;
+	}
+
+	for(i=0; i<num_texfiles; i++) {
+		if(read_comptex(ctx, texfiles[i], &ct) == -1) {
+			res = -1;
+			continue;
+		}
+		if(!(id = upload_comptex(&ct, 0))) {
+			free_comptex(&ct);
+			res = -1;
+			continue;
+		}
+		printf("%s: %s %dx%d, %d levels\n", texfiles[i], fmtstr(ct.fmt), ct.width, ct.height,
+				ct.levels);
+		bench_texture(id, ct.width, ct.height, ct.levels, stdout);
+
+		glDeleteTextures(1, &id);
+		free_comptex(&ct);
+	}
+
+	bench_destroy();
+	return res;
+}
+
+#define REGION_COUNT	4096
+#define REGION_SIZE		64
+
+/* time swizzling each texfile to every block layout and back, and reading
+ * random REGION_SIZE x REGION_SIZE regions out of it
+ */
+int run_regiontest(void)
+{
+	int i, bsize, res = 0, maxsz = 0;
+	struct comptex ct;
+	unsigned char *lin;
+	size_t size;
+
+	printf("%d random %dx%d regions per layout\n", REGION_COUNT, REGION_SIZE, REGION_SIZE);
+
+	for(i=0; i<num_texfiles; i++) {
+		if(read_comptex(ctx, texfiles[i], &ct) == -1) {
+			res = -1;
+			continue;
+		}
+		if(!(bsize = transcode_block_size(ct.fmt)) || !ct.data[0]) {
+			printf("%s: %s is not block-compressed, skipping\n", texfiles[i], fmtstr(ct.fmt));
+			free_comptex(&ct);
+			continue;
+		}
+		if(!(lin = malloc(ct.size[0]))) {
+			fprintf(stderr, "failed to allocate linear level (%u bytes)\n", ct.size[0]);
+			free_comptex(&ct);
+			res = -1;
+			continue;
+		}
+		comptex_linear_level(&ct, 0, lin);
+
+		printf("%s: %s %dx%d, %s block order\n", texfiles[i], fmtstr(ct.fmt), ct.width,
+				ct.height, layout_name(ct.layout));
+		if(region_test(lin, ct.width, ct.height, bsize) == -1) {
+			res = -1;
+		}
+		if(ct.width > maxsz) maxsz = ct.width;
+		if(ct.height > maxsz) maxsz = ct.height;
+
+		free(lin);
+		free_comptex(&ct);
+	}
+
+	/* small levels fit in the cache in any order, so the difference only
+	 * shows on a large one
+	 */
+	if(maxsz < 4096) {
+		size = (size_t)2048 * 2048 * 16;
+		if(!(lin = malloc(size))) {
+			fprintf(stderr, "failed to allocate synthetic level (%lu bytes)\n", (unsigned long)size);
+			return -1;
+		}
+		for(i=0; i<(int)size; i++) {
+			lin[i] = rand();
+		}
+		printf("synthetic 8192x8192, 16 byte blocks\n");
+		if(region_test(lin, 8192, 8192, 16) == -1) {
+			res = -1;
+		}
+		free(lin);
+	}
+	return res;
+}
+
+int region_test(const unsigned char *lin, int width, int height, int bsize)
+{
+	int i, lt, bw, bh, nreg;
+	size_t size;
+	double t0, t1, t2, mb;
+	unsigned char *sw, *back, *reg;
+	static int rx[REGION_COUNT], ry[REGION_COUNT];
+
+	bw = (width + 3) / 4;
+	bh = (height + 3) / 4;
+	size = (size_t)bw * bh * bsize;
+	mb = size / 1048576.0;
+
+	/* the same regions for every layout */
+	nreg = width >= REGION_SIZE && height >= REGION_SIZE ? REGION_COUNT : 0;
+	for(i=0; i<nreg; i++) {
+		rx[i] = rand() % (bw - REGION_SIZE / 4 + 1) * 4;
+		ry[i] = rand() % (bh - REGION_SIZE / 4 + 1) * 4;
+	}
+
+	sw = malloc(size);
+	back = malloc(size);
+	reg = malloc(REGION_SIZE * REGION_SIZE / 16 * bsize);
+	if(!sw || !back || !reg) {
+		fprintf(stderr, "failed to allocate region test buffers\n");
+		free(sw);
+		free(back);
+		free(reg);
+		return -1;
+	}
+
+	printf("  %-7s %14s %14s %12s\n", "layout", "swizzle MB/s", "unswizzle MB/s", "ns/region");
+	for(lt=0; lt<NUM_LAYOUTS; lt++) {
+		t0 = get_msec();
+		swizzle_level(lt, lin, sw, width, height, bsize);
+		t1 = get_msec();
+		unswizzle_level(lt, sw, back, width, height, bsize);
+		t2 = get_msec();
+
+		if(memcmp(lin, back, size) != 0) {
+			fprintf(stderr, "%s block order does not round-trip\n", layout_name(lt));
+			free(sw);
+			free(back);
+			free(reg);
+			return -1;
+		}
+		printf("  %-7s %14.1f %14.1f ", layout_name(lt), t1 > t0 ? mb * 1000.0 / (t1 - t0) : 0.0,
+				t2 > t1 ? mb * 1000.0 / (t2 - t1) : 0.0);
+
+		if(nreg) {
+			t0 = get_msec();
+			for(i=0; i<nreg; i++) {
+				extract_region(lt, sw, width, height, bsize, rx[i], ry[i], REGION_SIZE, REGION_SIZE, reg);
+			}
+			printf("%12.1f\n", (get_msec() - t0) * 1000000.0 / nreg);
+		} else {
+			printf("%12s\n", "-");
+		}
+	}
+
+	free(sw);
+	free(back);
+	free(reg);
+	return 0;
+}
+
+/* compare a block-aligned region read back from level 0 with the same
+ * region extracted on the CPU, from the block order of the file
+ */
+int check_region(const void *gpu, int x, int y, int w, int h)
+{
+	int res = 0, bsize = transcode_block_size(tex.fmt);
+	size_t size = (size_t)(w / 4) * (h / 4) * bsize;
+	unsigned char *sw = 0, *reg;
+	const void *src = tex.data;
+
+	if(!(reg = malloc(size))) {
+		fprintf(stderr, "failed to allocate region buffer\n");
+		return -1;
+	}
+	if(tex.layout != LAYOUT_LINEAR) {
+		if(!(sw = malloc(tex.compsize))) {
+			fprintf(stderr, "failed to allocate swizzled level\n");
+			free(reg);
+			return -1;
+		}
+		swizzle_level(tex.layout, tex.data, sw, tex.width, tex.height, bsize);
+		src = sw;
+	}
+	if(extract_region(tex.layout, src, tex.width, tex.height, bsize, x, y, w, h, reg) == -1) {
+		fprintf(stderr, "%dx%d region at %d,%d is outside the %dx%d level\n", w, h, x, y,
+				tex.width, tex.height);
+		res = -1;
+	} else if(memcmp(gpu, reg, size) != 0) {
+		fprintf(stderr, "retrieved %dx%d region at %d,%d differs from the %s data\n", w, h, x, y,
+				layout_name(tex.layout));
+		res = -1;
+	} else {
+		printf("retrieved %dx%d region matches the %s data\n", w, h, layout_name(tex.layout));
+	}
+	free(sw);
+	free(reg);
+	return res;
+}
+
+void iobench_upload(int idx, struct comptex *ct, void *cls)
+{
+	unsigned int id;
+
+	if((id = upload_comptex(ct, 0))) {
+		glDeleteTextures(1, &id);
+	}
+	free_comptex(ct);
+}
+
 void disp(void)
 {
-	int x = 0, y = 0;
 	int xsz = tex.width;
 	int ysz = tex.height;
+	unsigned int id = tex.id;
+	unsigned int fmt = tex.fmt;
+	static int checked_errors;
 
 	glClear(GL_COLOR_BUFFER_BIT);
 
-	glBindTexture(GL_TEXTURE_2D, tex.id);
-	glEnable(GL_TEXTURE_2D);
-
-	glBegin(GL_QUADS);
-	glTexCoord2f(0, 1); glVertex2f(0, 0);
-	glTexCoord2f(1, 1); glVertex2f(xsz, 0);
-	glTexCoord2f(1, 0); glVertex2f(xsz, ysz);
-	glTexCoord2f(0, 0);	glVertex2f(0, ysz);
+	if(soak) {
+		struct managed_tex *mt = soak_tex[frame++ % num_texfiles];
 
-	x += xsz;
-	xsz /= 2;
-	ysz /= 2;
+		if(texman_use(mt) == -1) {
+			fprintf(stderr, "soak test: failed to load %s\n", mt->fname);
+			exit(1);
+		}
+		id = mt->id;
+		xsz = mt->ct.width;
+		ysz = mt->ct.height;
+		fmt = mt->ct.fmt;
+
+		if(frame % 1000 == 0) {
+			printf("frame %lu\n", frame);
+			texman_print_stats(stdout);
+		}
+	}
 
-	while(xsz & ysz) {
-		glTexCoord2f(0, 1); glVertex2f(x, y);
-		glTexCoord2f(1, 1); glVertex2f(x + xsz, y);
-		glTexCoord2f(1, 0); glVertex2f(x + xsz, y + ysz);
-		glTexCoord2f(0, 0);	glVertex2f(x, y + ysz);
+	view_draw(id, xsz, ysz, instances);
+	view_draw_overlay(fmtstr(fmt));
 
-		y += ysz;
+	glutSwapBuffers();
 
-		xsz /= 2;
-		ysz /= 2;
+	/* once is enough, checking every frame would stall the pipeline */
+	if(!checked_errors) {
+		assert(glGetError() == GL_NO_ERROR);
+		checked_errors = 1;
 	}
-	glEnd();
-
-	glutSwapBuffers();
-	assert(glGetError() == GL_NO_ERROR);
 }
 
 void reshape(int x, int y)
 {
 	glViewport(0, 0, x, y);
-
-	glMatrixMode(GL_PROJECTION);
-	glLoadIdentity();
-	glOrtho(0, x, 0, y, -1, 1);
+	view_resize(x, y);
 }
 
 void keyb(unsigned char key, int x, int y)
 {
-	if(key == 27) {
+	switch(key) {
+	case 27:
+		if(soak) {
+			texman_print_stats(stdout);
+			texman_destroy();
+		}
 		exit(0);
+
+	case '+':
+	case '=':
+		instances *= 2;
+		glutPostRedisplay();
+		break;
+
+	case '-':
+		if(instances > 1) {
+			instances /= 2;
+			glutPostRedisplay();
+		}
+		break;
+
+	default:
+		break;
 	}
 }
 
@@ -234,213 +790,109 @@ void gen_image(unsigned char *pixels, int xsz, int ysz)
 	}
 }
 
-struct header {
-	char magic[8];
-	uint32_t glfmt;
-	uint16_t flags;
-	uint16_t levels;
-	uint32_t width, height;
-	struct {
-		uint32_t offset, size;
-	} datadesc[20];
-	char unused[8];
-};
-
-int load_texture(const char *fname, struct texture *tex)
+static int write_file(const char *dir, const char *name, size_t size, time_t age)
 {
-	int i;
+	char path[1024];
 	FILE *fp;
-	struct header hdr;
-	void *buf;
+	struct timeval tv[2];
 
-	if(!(fp = fopen(fname, "rb"))) {
-		fprintf(stderr, "failed to open file: %s: %s\n", fname, strerror(errno));
+	snprintf(path, sizeof path, "%s/%s", dir, name);
+	if(!(fp = fopen(path, "wb"))) {
+		fprintf(stderr, "failed to create %s: %s\n", path, strerror(errno));
 		return -1;
 	}
-	if(fread(&hdr, 1, sizeof hdr, fp) != sizeof hdr) {
-		fprintf(stderr, "failed to read image file header: %s: %s\n", fname, strerror(errno));
-		fclose(fp);
-		return -1;
-	}
-	if(memcmp(hdr.magic, "COMPTEX0", sizeof hdr.magic) != 0 || hdr.levels < 0 ||
-			hdr.levels > 20 || !hdr.datadesc[0].size) {
-		fprintf(stderr, "%s is not a compressed texture file, or is corrupted\n", fname);
-		fclose(fp);
-		return -1;
+	while(size-- > 0) {
+		fputc(0, fp);
 	}
+	fclose(fp);
 
-	if(!(buf = malloc(hdr.datadesc[0].size))) {
-		fprintf(stderr, "failed to allocate compressed texture buffer (%d bytes): %s\n",
-				hdr.datadesc[0].size, strerror(errno));
-		fclose(fp);
-		return -1;
-	}
-	if(!(tex->data = malloc(hdr.datadesc[0].size))) {
-		fprintf(stderr, "failed to allocate data buffer\n");
-		fclose(fp);
-		free(buf);
-		return -1;
+	if(age) {
+		gettimeofday(tv, 0);
+		tv[0].tv_sec -= age;
+		tv[1] = tv[0];
+		utimes(path, tv);
 	}
+	return 0;
+}
 
+static int file_exists(const char *dir, const char *name)
+{
+	char path[1024];
+	struct stat st;
 
-	glGenTextures(1, &tex->id);
-	glBindTexture(GL_TEXTURE_2D, tex->id);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
-			hdr.levels > 1 ? GL_NEAREST_MIPMAP_NEAREST : GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	snprintf(path, sizeof path, "%s/%s", dir, name);
+	return stat(path, &st) == 0;
+}
 
-	tex->fmt = hdr.glfmt;
-	tex->width = hdr.width;
-	tex->height = hdr.height;
-	tex->compsize = hdr.datadesc[0].size;
+#define CT_ENTRY_SIZE	4096
+#define CT_MAX_ENTRIES	3
 
-	printf("%s: %dx%d format: %s\n", fname, tex->width, tex->height, fmtstr(tex->fmt));
-	glutReshapeWindow(tex->width + tex->width / 2, tex->height);
+/* fill a cache in dir past its size cap, next to files it didn't write, and
+ * check that only its own entries and stale temporary files get deleted
+ */
+int run_cachetest(const char *dir)
+{
+	int i, res = 0;
+	struct cache *cache;
+	void *data;
+	size_t size;
+	static char buf[CT_ENTRY_SIZE];
 
-	for(i=0; i<hdr.levels; i++) {
-		if(!hdr.datadesc[i].size) {
-			continue;
-		}
+	/* not cache entries, even though some look close */
+	static const char *foreign[] = {
+		"notes.txt", "0123456789abcdef.png", "0123456789ABCDEF.tc", "0123456789abcdef.tc.bak",
+		".tmp-keep", ".tmp-AbC123.old", 0
+	};
 
-		if(fread(buf, 1, hdr.datadesc[i].size, fp) != hdr.datadesc[i].size) {
-			fprintf(stderr, "unexpected EOF while reading texture: %s\n", fname);
-			fclose(fp);
-			free(buf);
-			glDeleteTextures(1, &tex->id);
+	if(mkdir(dir, 0775) == -1 && errno != EEXIST) {
+		fprintf(stderr, "failed to create %s: %s\n", dir, strerror(errno));
+		return -1;
+	}
+	for(i=0; foreign[i]; i++) {
+		if(write_file(dir, foreign[i], CT_ENTRY_SIZE, 7200) == -1) {
 			return -1;
 		}
-		if(i == 0) {
-			memcpy(tex->data, buf, hdr.datadesc[0].size);
-		}
-		glCompressedTexImage2D(GL_TEXTURE_2D, i, hdr.glfmt, hdr.width, hdr.height, 0,
-				hdr.datadesc[i].size, buf);
-
-		hdr.width /= 2;
-		hdr.height /= 2;
 	}
-
-	free(buf);
-	fclose(fp);
-	return 0;
-}
-
-const char *fmtstr(int fmt)
-{
-	switch(fmt) {
-	case 0x86b0: return "GL_COMPRESSED_RGB_FXT1_3DFX";
-	case 0x86b1: return "GL_COMPRESSED_RGBA_FXT1_3DFX";
-	case 0x8dbb: return "GL_COMPRESSED_RED_RGTC1";
-	case 0x8dbc: return "GL_COMPRESSED_SIGNED_RED_RGTC1";
-	case 0x8dbd: return "GL_COMPRESSED_RG_RGTC2";
-	case 0x8dbe: return "GL_COMPRESSED_SIGNED_RG_RGTC2";
-	case 0x8e8c: return "GL_COMPRESSED_RGBA_BPTC_UNORM";
-	case 0x8e8d: return "GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM";
-	case 0x8e8e: return "GL_COMPRESSED_RGB_BPTC_SIGNED_FLOAT";
-	case 0x8e8f: return "GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT";
-	case 0x9274: return "GL_COMPRESSED_RGB8_ETC2";
-	case 0x9275: return "GL_COMPRESSED_SRGB8_ETC2";
-	case 0x9276: return "GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2";
-	case 0x9277: return "GL_COMPRESSED_SRGB8_PUNCHTHROUGH_ALPHA1_ETC2";
-	case 0x9278: return "GL_COMPRESSED_RGBA8_ETC2_EAC";
-	case 0x9279: return "GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC";
-	case 0x9270: return "GL_COMPRESSED_R11_EAC";
-	case 0x9271: return "GL_COMPRESSED_SIGNED_R11_EAC";
-	case 0x9272: return "GL_COMPRESSED_RG11_EAC";
-	case 0x9273: return "GL_COMPRESSED_SIGNED_RG11_EAC";
-	case 0x83F0: return "GL_COMPRESSED_RGB_S3TC_DXT1_EXT";
-	case 0x83F1: return "GL_COMPRESSED_RGBA_S3TC_DXT1_EXT";
-	case 0x83F2: return "GL_COMPRESSED_RGBA_S3TC_DXT3_EXT";
-	case 0x83F3: return "GL_COMPRESSED_RGBA_S3TC_DXT5_EXT";
-	case 0x8C48: return "GL_COMPRESSED_SRGB_EXT";
-	case 0x8C49: return "GL_COMPRESSED_SRGB_ALPHA_EXT";
-	case 0x8C4A: return "GL_COMPRESSED_SLUMINANCE_EXT";
-	case 0x8C4B: return "GL_COMPRESSED_SLUMINANCE_ALPHA_EXT";
-	case 0x8C4C: return "GL_COMPRESSED_SRGB_S3TC_DXT1_EXT";
-	case 0x8C4D: return "GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT";
-	case 0x8C4E: return "GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT";
-	case 0x8C4F: return "GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT";
-	case 0x8B90: return "GL_PALETTE4_RGB8_OES";
-	case 0x8B91: return "GL_PALETTE4_RGBA8_OES";
-	case 0x8B92: return "GL_PALETTE4_R5_G6_B5_OES";
-	case 0x8B93: return "GL_PALETTE4_RGBA4_OES";
-	case 0x8B94: return "GL_PALETTE4_RGB5_A1_OES";
-	case 0x8B95: return "GL_PALETTE8_RGB8_OES";
-	case 0x8B96: return "GL_PALETTE8_RGBA8_OES";
-	case 0x8B97: return "GL_PALETTE8_R5_G6_B5_OES";
-	case 0x8B98: return "GL_PALETTE8_RGBA4_OES";
-	case 0x8B99: return "GL_PALETTE8_RGB5_A1_OES";
-	case 0x93B0: return "GL_COMPRESSED_RGBA_ASTC_4";
-	case 0x93B1: return "GL_COMPRESSED_RGBA_ASTC_5";
-	case 0x93B2: return "GL_COMPRESSED_RGBA_ASTC_5";
-	case 0x93B3: return "GL_COMPRESSED_RGBA_ASTC_6";
-	case 0x93B4: return "GL_COMPRESSED_RGBA_ASTC_6";
-	case 0x93B5: return "GL_COMPRESSED_RGBA_ASTC_8";
-	case 0x93B6: return "GL_COMPRESSED_RGBA_ASTC_8";
-	case 0x93B7: return "GL_COMPRESSED_RGBA_ASTC_8";
-	case 0x93B8: return "GL_COMPRESSED_RGBA_ASTC_10";
-	case 0x93B9: return "GL_COMPRESSED_RGBA_ASTC_10";
-	case 0x93BA: return "GL_COMPRESSED_RGBA_ASTC_10";
-	case 0x93BB: return "GL_COMPRESSED_RGBA_ASTC_10";
-	case 0x93BC: return "GL_COMPRESSED_RGBA_ASTC_12";
-	case 0x93BD: return "GL_COMPRESSED_RGBA_ASTC_12";
-	case 0x93D0: return "GL_COMPRESSED_SRGB8_ALPHA8_ASTC_4";
-	case 0x93D1: return "GL_COMPRESSED_SRGB8_ALPHA8_ASTC_5";
-	case 0x93D2: return "GL_COMPRESSED_SRGB8_ALPHA8_ASTC_5";
-	case 0x93D3: return "GL_COMPRESSED_SRGB8_ALPHA8_ASTC_6";
-	case 0x93D4: return "GL_COMPRESSED_SRGB8_ALPHA8_ASTC_6";
-	case 0x93D5: return "GL_COMPRESSED_SRGB8_ALPHA8_ASTC_8";
-	case 0x93D6: return "GL_COMPRESSED_SRGB8_ALPHA8_ASTC_8";
-	case 0x93D7: return "GL_COMPRESSED_SRGB8_ALPHA8_ASTC_8";
-	case 0x93D8: return "GL_COMPRESSED_SRGB8_ALPHA8_ASTC_10";
-	case 0x93D9: return "GL_COMPRESSED_SRGB8_ALPHA8_ASTC_10";
-	case 0x93DA: return "GL_COMPRESSED_SRGB8_ALPHA8_ASTC_10";
-	case 0x93DB: return "GL_COMPRESSED_SRGB8_ALPHA8_ASTC_10";
-	case 0x93DC: return "GL_COMPRESSED_SRGB8_ALPHA8_ASTC_12";
-	case 0x93DD: return "GL_COMPRESSED_SRGB8_ALPHA8_ASTC_12";
-	case GL_LUMINANCE:
-	case 1:
-		return "GL_LUMINANCE";
-	case GL_RGB:
-	case 3:
-		return "GL_RGB";
-	case GL_RGBA:
-	case 4:
-		return "GL_RGBA";
-	case GL_BGR: return "GL_BGR";
-	case GL_BGRA: return "GL_BGRA";
-	case GL_SLUMINANCE: return "GL_SLUMINANCE";
-	case GL_SLUMINANCE8: return "GL_SLUMINANCE8";
-	case GL_SLUMINANCE_ALPHA: return "GL_SLUMINANCE_ALPHA";
-	case GL_SLUMINANCE8_ALPHA8: return "GL_SLUMINANCE8_ALPHA8";
-	case GL_SRGB: return "GL_SRGB";
-	case GL_SRGB8: return "GL_SRGB8";
-	case GL_SRGB_ALPHA: return "GL_SRGB_ALPHA";
-	case GL_SRGB8_ALPHA8: return "GL_SRGB8_ALPHA8";
-	default:
-		break;
+	/* a temporary file left behind two hours ago, and one being written */
+	if(write_file(dir, ".tmp-AbC123", CT_ENTRY_SIZE, 7200) == -1 ||
+			write_file(dir, ".tmp-XyZ789", CT_ENTRY_SIZE, 0) == -1) {
+		return -1;
 	}
-	return "unknown";
-}
-
-void print_compressed_formats(void)
-{
-	int i, num_fmt;
-	int *fmtlist;
-
-	glGetIntegerv(GL_NUM_COMPRESSED_TEXTURE_FORMATS, &num_fmt);
-	printf("%d generic compressed texture formats available:\n", num_fmt);
 
-	if(!(fmtlist = malloc(num_fmt * sizeof *fmtlist))) {
-		fprintf(stderr, "failed to allocate texture formats enumeration buffer\n");
-		return;
+	if(!(cache = cache_open(dir, CT_MAX_ENTRIES * CT_ENTRY_SIZE))) {
+		return -1;
+	}
+	for(i=0; i<10; i++) {
+		if(cache_store(cache, i, "tc", buf, sizeof buf) == -1) {
+			res = -1;
+		}
 	}
-	glGetIntegerv(GL_COMPRESSED_TEXTURE_FORMATS, fmtlist);
 
-	for(i=0; i<num_fmt; i++) {
-		printf(" %05x: %s ", fmtlist[i], fmtstr(fmtlist[i]));
-		GLint params;
-		glGetInternalformativ(GL_TEXTURE_2D, fmtlist[i], GL_TEXTURE_COMPRESSED, 1, &params);
-		printf("(%s format)\n", params == GL_TRUE ? "compressed" : "not compressed");
+	for(i=0; foreign[i]; i++) {
+		if(!file_exists(dir, foreign[i])) {
+			fprintf(stderr, "cache test: foreign file %s was deleted\n", foreign[i]);
+			res = -1;
+		}
+	}
+	if(file_exists(dir, ".tmp-AbC123")) {
+		fprintf(stderr, "cache test: stale temporary file was not deleted\n");
+		res = -1;
 	}
-	free(fmtlist);
+	if(!file_exists(dir, ".tmp-XyZ789")) {
+		fprintf(stderr, "cache test: fresh temporary file was deleted\n");
+		res = -1;
+	}
+	for(i=0; i<10; i++) {
+		if((data = cache_map(cache, i, "tc", &size))) {
+			cache_unmap(data, size);
+		}
+		if((data != 0) != (i >= 10 - CT_MAX_ENTRIES)) {
+			fprintf(stderr, "cache test: entry %d was %s\n", i, data ? "kept" : "evicted");
+			res = -1;
+		}
+	}
+	cache_close(cache);
+
+	printf("cache test %s\n", res == -1 ? "failed" : "passed");
+	return res;
 }
@@ -0,0 +1,449 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <sys/stat.h>
+#include <GL/glew.h>
+#include "perfcheck.h"
+#include "texture.h"
+#include "texgl.h"
+#include "comptex.h"
+#include "transcode.h"
+#include "swizzle.h"
+
+/* timed runs per stage and texture, after one untimed warm-up run */
+#define NUM_RUNS	7
+#define MAX_METRICS	256
+
+enum { ST_LOAD, ST_UPLOAD, ST_READBACK, ST_DECODE, NUM_STAGES };
+static const char *stage_names[] = {"load", "upload", "readback", "decode"};
+
+/* tolerance of new metrics in percent, the GL stages are noisier */
+static const double stage_tol[] = {25.0, 30.0, 30.0, 15.0};
+
+static const struct {
+	const char *name;
+	unsigned int fmt;
+} formats[] = {
+	{"etc2", TC_RGB8_ETC2},
+	{"etc2a", TC_RGBA8_ETC2_EAC},
+	{"dxt1", TC_RGB_S3TC_DXT1},
+	{"dxt5", TC_RGBA_S3TC_DXT5}
+};
+#define NUM_FORMATS	(sizeof formats / sizeof *formats)
+
+static const int sizes[] = {256, 1024, 2048};
+#define NUM_SIZES	(sizeof sizes / sizeof *sizes)
+
+struct metric {
+	char name[64];
+	double median, mad;	/* milliseconds */
+	double tol;			/* percent */
+};
+
+static int gen_texture(const char *fname, unsigned int fmt, int size, int mips, int layout);
+static int measure(struct comptex_ctx *ctx, const char *fname, const char *name, struct metric *m,
+		int *num_metrics);
+static void calc_stats(double *v, int n, struct metric *m);
+static int read_baseline(const char *fname, struct metric *base, char *renderer, int rsize);
+static int write_baseline(const char *fname, const struct metric *m, int num,
+		const struct metric *base, int num_base);
+static int compare(const struct metric *m, int num, const struct metric *base, int num_base);
+static const struct metric *find_metric(const struct metric *m, int num, const char *name);
+
+
+int perfcheck(struct comptex_ctx *ctx, const char *dir, int update)
+{
+	int j, var, num = 0, num_base, res = 0;
+	unsigned int k;
+	char *fname, *corpus, renderer[256];
+	char name[64];
+	const char *rstr;
+	struct stat st;
+	static struct metric m[MAX_METRICS], base[MAX_METRICS];
+
+	if(!(fname = malloc(strlen(dir) + 128)) || !(corpus = malloc(strlen(dir) + 16))) {
+		fprintf(stderr, "failed to allocate file name\n");
+		free(fname);
+		return -1;
+	}
+	sprintf(corpus, "%s/corpus", dir);
+	if((mkdir(dir, 0775) == -1 && errno != EEXIST) || (mkdir(corpus, 0775) == -1 && errno != EEXIST)) {
+		fprintf(stderr, "failed to create %s: %s\n", corpus, strerror(errno));
+		goto err;
+	}
+
+	if(!(rstr = (const char*)glGetString(GL_RENDERER))) {
+		rstr = "unknown";
+	}
+
+	/* a missing baseline has to be recorded on purpose, otherwise the first
+	 * run of a broken checkout would pass by writing its own numbers
+	 */
+	sprintf(fname, "%s/baseline", dir);
+	if((num_base = read_baseline(fname, base, renderer, sizeof renderer)) <= 0) {
+		if(!update) {
+			fprintf(stderr, "%s %s, record one with make perfcheck-update\n", fname,
+					num_base == -1 ? "doesn't exist" : "has no metrics");
+			goto err;
+		}
+		num_base = 0;
+	} else if(!update && strcmp(renderer, rstr) != 0) {
+		printf("warning: baseline was measured on %s\n", renderer);
+	}
+
+	printf("perfcheck: %s, %d runs per measurement\n", rstr, NUM_RUNS);
+
+	/* every format and size, with only the base level and with the whole mip
+	 * chain, and the whole chain of the largest ones in Z-order too
+	 */
+	for(k=0; k<NUM_FORMATS; k++) {
+		for(j=0; j<(int)NUM_SIZES; j++) {
+			for(var=0; var<3; var++) {
+				int mips = var > 0;
+				int layout = var == 2 ? LAYOUT_MORTON : LAYOUT_LINEAR;
+				if(var == 2 && j < (int)NUM_SIZES - 1) {
+					continue;
+				}
+				sprintf(name, "%s-%d-%s%s", formats[k].name, sizes[j], mips ? "mips" : "base",
+						layout == LAYOUT_MORTON ? "-morton" : "");
+				sprintf(fname, "%s/%s.tex", corpus, name);
+
+				if(stat(fname, &st) == -1 && gen_texture(fname, formats[k].fmt, sizes[j],
+							mips, layout) == -1) {
+					goto err;
+				}
+				if(measure(ctx, fname, name, m, &num) == -1) {
+					goto err;
+				}
+			}
+		}
+	}
+
+	sprintf(fname, "%s/baseline", dir);
+	if(update) {
+		if(write_baseline(fname, m, num, base, num_base) == -1) {
+			goto err;
+		}
+		printf("wrote %d metrics to %s\n", num, fname);
+	} else {
+		res = compare(m, num, base, num_base);
+	}
+
+	free(corpus);
+	free(fname);
+	return res;
+
+err:
+	free(corpus);
+	free(fname);
+	return -1;
+}
+
+/* a COMPTEX0 file with pseudo-random blocks, which decode fine in any of
+ * the formats in the corpus. The same every time, the seed is fixed.
+ */
+static int gen_texture(const char *fname, unsigned int fmt, int size, int mips, int layout)
+{
+	int i, sz;
+	uint32_t pos = 0, seed = 0x2545f491;
+	unsigned int j;
+	struct comptex_header hdr;
+	unsigned char *buf;
+	FILE *fp;
+
+	memset(&hdr, 0, sizeof hdr);
+	memcpy(hdr.magic, "COMPTEX0", sizeof hdr.magic);
+	hdr.glfmt = fmt;
+	hdr.flags = 1 | COMPTEX_LAYOUT_FLAGS(layout);
+	hdr.width = hdr.height = size;
+
+	for(sz=size; ; sz>>=1) {
+		i = hdr.levels++;
+		hdr.datadesc[i].offset = pos;
+		hdr.datadesc[i].size = transcode_level_size(fmt, sz, sz);
+		pos += hdr.datadesc[i].size;
+		if(!mips || sz <= 1) break;
+	}
+
+	if(!(buf = malloc(hdr.datadesc[0].size))) {
+		fprintf(stderr, "failed to allocate corpus texture (%u bytes)\n", hdr.datadesc[0].size);
+		return -1;
+	}
+	if(!(fp = fopen(fname, "wb"))) {
+		fprintf(stderr, "failed to open %s for writing: %s\n", fname, strerror(errno));
+		free(buf);
+		return -1;
+	}
+	if(fwrite(&hdr, sizeof hdr, 1, fp) != 1) {
+		goto err;
+	}
+	for(i=0; i<hdr.levels; i++) {
+		for(j=0; j<hdr.datadesc[i].size; j++) {
+			seed = seed * 1664525 + 1013904223;
+			buf[j] = seed >> 24;
+		}
+		if(fwrite(buf, 1, hdr.datadesc[i].size, fp) != hdr.datadesc[i].size) {
+			goto err;
+		}
+	}
+	free(buf);
+	if(fclose(fp) == EOF) {
+		fprintf(stderr, "failed to write %s: %s\n", fname, strerror(errno));
+		remove(fname);
+		return -1;
+	}
+	return 0;
+
+err:
+	fprintf(stderr, "failed to write %s: %s\n", fname, strerror(errno));
+	free(buf);
+	fclose(fp);
+	remove(fname);
+	return -1;
+}
+
+/* run every stage on fname NUM_RUNS times, adding a metric per stage to m */
+static int measure(struct comptex_ctx *ctx, const char *fname, const char *name, struct metric *m,
+		int *num_metrics)
+{
+	int i, run, decode, compressed;
+	unsigned int id;
+	double t[NUM_STAGES][NUM_RUNS], t0;
+	struct comptex ct;
+	struct comptex_file *cf;
+	struct comptex_info info;
+	unsigned char *buf = 0, *rgba = 0;
+
+	if(*num_metrics + NUM_STAGES > MAX_METRICS) {
+		fprintf(stderr, "too many perfcheck metrics\n");
+		return -1;
+	}
+	if(!(cf = comptex_open(fname))) {
+		return -1;
+	}
+	comptex_get_info(cf, &info);
+	if((decode = transcode_can_decode(info.glfmt))) {
+		if(!(rgba = malloc(info.width * info.height * 4))) {
+			fprintf(stderr, "failed to allocate decoding buffer\n");
+			comptex_close(cf);
+			return -1;
+		}
+	}
+
+	for(run=-1; run<NUM_RUNS; run++) {
+		t0 = get_msec();
+		if(read_comptex(ctx, fname, &ct) == -1) {
+			goto err;
+		}
+		if(run >= 0) t[ST_LOAD][run] = get_msec() - t0;
+
+		t0 = get_msec();
+		if(!(id = upload_comptex(&ct, 0))) {
+			free_comptex(&ct);
+			goto err;
+		}
+		glFinish();
+		if(run >= 0) t[ST_UPLOAD][run] = get_msec() - t0;
+
+		if(!buf && !(buf = malloc(ct.size[0]))) {
+			fprintf(stderr, "failed to allocate readback buffer (%u bytes)\n", ct.size[0]);
+			glDeleteTextures(1, &id);
+			free_comptex(&ct);
+			goto err;
+		}
+		/* uncompressed if the driver couldn't take the format */
+		compressed = transcode_is_compressed(ct.fmt);
+
+		t0 = get_msec();
+		if(compressed) {
+			glGetCompressedTexImage(GL_TEXTURE_2D, 0, buf);
+		} else {
+			glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, buf);
+		}
+		if(run >= 0) t[ST_READBACK][run] = get_msec() - t0;
+
+		glDeleteTextures(1, &id);
+		free_comptex(&ct);
+
+		if(decode) {
+			t0 = get_msec();
+			if(comptex_decode_level(cf, 0, rgba, 0) == -1) {
+				goto err;
+			}
+			if(run >= 0) t[ST_DECODE][run] = get_msec() - t0;
+		}
+	}
+
+	for(i=0; i<NUM_STAGES; i++) {
+		if(i == ST_DECODE && !decode) continue;
+
+		sprintf(m[*num_metrics].name, "%s/%s", stage_names[i], name);
+		m[*num_metrics].tol = stage_tol[i];
+		calc_stats(t[i], NUM_RUNS, m + *num_metrics);
+		++*num_metrics;
+	}
+
+	free(buf);
+	free(rgba);
+	comptex_close(cf);
+	return 0;
+
+err:
+	free(buf);
+	free(rgba);
+	comptex_close(cf);
+	return -1;
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+	double x = *(const double*)a, y = *(const double*)b;
+	return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+static double median(double *v, int n)
+{
+	qsort(v, n, sizeof *v, cmp_double);
+	return n & 1 ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) * 0.5;
+}
+
+/* median, and median absolute deviation from it, of the n samples in v */
+static void calc_stats(double *v, int n, struct metric *m)
+{
+	int i;
+	double dev[NUM_RUNS];
+
+	m->median = median(v, n);
+	for(i=0; i<n; i++) {
+		dev[i] = fabs(v[i] - m->median);
+	}
+	m->mad = median(dev, n);
+}
+
+/* returns the number of metrics read, or -1 if there's no baseline */
+static int read_baseline(const char *fname, struct metric *base, char *renderer, int rsize)
+{
+	int num = 0, line = 0;
+	char buf[512], *ptr;
+	FILE *fp;
+
+	if(!(fp = fopen(fname, "r"))) {
+		return -1;
+	}
+	renderer[0] = 0;
+
+	while(fgets(buf, sizeof buf, fp)) {
+		line++;
+		if((ptr = strchr(buf, '\n'))) *ptr = 0;
+
+		if(memcmp(buf, "# renderer: ", 12) == 0) {
+			strncpy(renderer, buf + 12, rsize - 1);
+			renderer[rsize - 1] = 0;
+			continue;
+		}
+		if(buf[0] == '#' || buf[strspn(buf, " \t")] == 0) {
+			continue;
+		}
+		if(num >= MAX_METRICS) {
+			fprintf(stderr, "%s: too many metrics, ignoring the rest\n", fname);
+			break;
+		}
+		if(sscanf(buf, "%63s %lf %lf %lf", base[num].name, &base[num].median, &base[num].mad,
+					&base[num].tol) != 4) {
+			fprintf(stderr, "%s:%d: invalid baseline line, ignoring\n", fname, line);
+			continue;
+		}
+		num++;
+	}
+	fclose(fp);
+	return num;
+}
+
+static int write_baseline(const char *fname, const struct metric *m, int num,
+		const struct metric *base, int num_base)
+{
+	int i;
+	const char *rstr;
+	const struct metric *b;
+	FILE *fp;
+
+	if(!(fp = fopen(fname, "w"))) {
+		fprintf(stderr, "failed to open %s for writing: %s\n", fname, strerror(errno));
+		return -1;
+	}
+	if(!(rstr = (const char*)glGetString(GL_RENDERER))) {
+		rstr = "unknown";
+	}
+
+	fprintf(fp, "# perfcheck baseline: median and median absolute deviation of %d runs in\n", NUM_RUNS);
+	fprintf(fp, "# milliseconds, and how much slower (in percent) still passes\n");
+	fprintf(fp, "# renderer: %s\n", rstr);
+	for(i=0; i<num; i++) {
+		b = find_metric(base, num_base, m[i].name);
+		fprintf(fp, "%-28s %10.4f %10.4f %6.1f\n", m[i].name, m[i].median, m[i].mad,
+				b ? b->tol : m[i].tol);
+	}
+
+	if(fclose(fp) == EOF) {
+		fprintf(stderr, "failed to write %s: %s\n", fname, strerror(errno));
+		return -1;
+	}
+	return 0;
+}
+
+/* print every metric next to its baseline, returns -1 if any regressed. A
+ * metric regresses if its median is slower than the tolerance allows, by
+ * more than the noise of the two measurements.
+ */
+static int compare(const struct metric *m, int num, const struct metric *base, int num_base)
+{
+	int i, nreg = 0;
+	double change, noise;
+	const struct metric *b;
+
+	printf("%-28s %20s %20s %9s\n", "metric (ms)", "baseline (mad)", "current (mad)", "change");
+	for(i=0; i<num; i++) {
+		if(!(b = find_metric(base, num_base, m[i].name))) {
+			printf("%-28s %20s %10.3f (%7.3f) %9s\n", m[i].name, "-", m[i].median, m[i].mad, "new");
+			continue;
+		}
+		change = b->median > 0.0 ? (m[i].median - b->median) / b->median * 100.0 : 0.0;
+		noise = 3.0 * (b->mad + m[i].mad);
+
+		printf("%-28s %10.3f (%7.3f) %10.3f (%7.3f) %+8.1f%%", m[i].name, b->median, b->mad,
+				m[i].median, m[i].mad, change);
+		if(change > b->tol && m[i].median - b->median > noise) {
+			printf("  REGRESSION (tolerance %.0f%%)\n", b->tol);
+			nreg++;
+		} else {
+			putchar('\n');
+		}
+	}
+	for(i=0; i<num_base; i++) {
+		if(!find_metric(m, num, base[i].name)) {
+			printf("%-28s %10.3f (%7.3f) %20s %9s\n", base[i].name, base[i].median, base[i].mad,
+					"-", "missing");
+		}
+	}
+
+	if(nreg) {
+		printf("%d of %d metrics regressed\n", nreg, num);
+		return -1;
+	}
+	printf("no regressions in %d metrics\n", num);
+	return 0;
+}
+
+static const struct metric *find_metric(const struct metric *m, int num, const char *name)
+{
+	int i;
+
+	for(i=0; i<num; i++) {
+		if(strcmp(m[i].name, name) == 0) {
+			return m + i;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,17 @@
+#ifndef PERFCHECK_H_
+#define PERFCHECK_H_
+
+#include "comptex.h"
+
+/* performance regression check: load, upload, read back and decode a fixed
+ * corpus of generated textures in dir/corpus, and compare the median time of
+ * each stage and texture against dir/baseline. The corpus is generated the
+ * first time. Needs a current GL context.
+ *
+ * Returns -1 on failure, if anything regressed, or if there's no baseline.
+ * If update is set, the results are written as the new baseline instead,
+ * keeping the tolerances of the metrics already in there.
+ */
+int perfcheck(struct comptex_ctx *ctx, const char *dir, int update);
+
+#endif	/* PERFCHECK_H_ */
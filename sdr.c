@@ -0,0 +1,60 @@
+#include <stdio.h>
+#include <GL/glew.h>
+#include "sdr.h"
+
+static unsigned int create_shader(unsigned int type, const char *src);
+
+unsigned int create_program(const char *vsrc, const char *psrc, const char **attr_names)
+{
+	int i, status;
+	unsigned int vs, ps, prog;
+	char buf[512];
+
+	if(!(vs = create_shader(GL_VERTEX_SHADER, vsrc))) {
+		return 0;
+	}
+	if(!(ps = create_shader(GL_FRAGMENT_SHADER, psrc))) {
+		glDeleteShader(vs);
+		return 0;
+	}
+
+	prog = glCreateProgram();
+	glAttachShader(prog, vs);
+	glAttachShader(prog, ps);
+	for(i=0; attr_names && attr_names[i]; i++) {
+		glBindAttribLocation(prog, i, attr_names[i]);
+	}
+	glLinkProgram(prog);
+	glDeleteShader(vs);
+	glDeleteShader(ps);
+
+	glGetProgramiv(prog, GL_LINK_STATUS, &status);
+	if(!status) {
+		glGetProgramInfoLog(prog, sizeof buf, 0, buf);
+		fprintf(stderr, "failed to link shader program:\n%s\n", buf);
+		glDeleteProgram(prog);
+		return 0;
+	}
+	return prog;
+}
+
+static unsigned int create_shader(unsigned int type, const char *src)
+{
+	unsigned int sdr;
+	int status;
+	char buf[512];
+
+	sdr = glCreateShader(type);
+	glShaderSource(sdr, 1, &src, 0);
+	glCompileShader(sdr);
+
+	glGetShaderiv(sdr, GL_COMPILE_STATUS, &status);
+	if(!status) {
+		glGetShaderInfoLog(sdr, sizeof buf, 0, buf);
+		fprintf(stderr, "failed to compile %s shader:\n%s\n",
+				type == GL_VERTEX_SHADER ? "vertex" : "fragment", buf);
+		glDeleteShader(sdr);
+		return 0;
+	}
+	return sdr;
+}
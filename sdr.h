@@ -0,0 +1,10 @@
+#ifndef SDR_H_
+#define SDR_H_
+
+/* compile and link a GLSL program out of a vertex and a fragment shader.
+ * Attributes in attr_names (0-terminated, may be 0) are bound to locations
+ * in order. Returns 0 on failure.
+ */
+unsigned int create_program(const char *vsrc, const char *psrc, const char **attr_names);
+
+#endif	/* SDR_H_ */
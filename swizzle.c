@@ -0,0 +1,190 @@
+#include <string.h>
+#include "swizzle.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define T	LAYOUT_TILE
+
+/* Z-order index of block x, y within a tile. Blocks 2n and 2n+1 of a tile
+ * row are always next to each other, so they're moved in pairs.
+ */
+static const unsigned char morton[T][T] = {
+	{ 0,  1,  4,  5, 16, 17, 20, 21},
+	{ 2,  3,  6,  7, 18, 19, 22, 23},
+	{ 8,  9, 12, 13, 24, 25, 28, 29},
+	{10, 11, 14, 15, 26, 27, 30, 31},
+	{32, 33, 36, 37, 48, 49, 52, 53},
+	{34, 35, 38, 39, 50, 51, 54, 55},
+	{40, 41, 44, 45, 56, 57, 60, 61},
+	{42, 43, 46, 47, 58, 59, 62, 63}
+};
+
+static void reorder(int layout, unsigned char *lin, unsigned char *sw, int width, int height,
+		int bsize, int to_layout);
+static int block_index(int layout, int bx, int by, int bw, int bh, int *run);
+
+const char *layout_name(int layout)
+{
+	switch(layout) {
+	case LAYOUT_LINEAR:
+		return "linear";
+	case LAYOUT_TILED:
+		return "tiled";
+	case LAYOUT_MORTON:
+		return "morton";
+	default:
+		break;
+	}
+	return "unknown";
+}
+
+int layout_from_name(const char *name)
+{
+	int i;
+
+	for(i=0; i<NUM_LAYOUTS; i++) {
+		if(strcmp(name, layout_name(i)) == 0) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+void swizzle_level(int layout, const void *src, void *dst, int width, int height, int bsize)
+{
+	reorder(layout, (unsigned char*)src, dst, width, height, bsize, 1);
+}
+
+void unswizzle_level(int layout, const void *src, void *dst, int width, int height, int bsize)
+{
+	reorder(layout, dst, (unsigned char*)src, width, height, bsize, 0);
+}
+
+int extract_region(int layout, const void *src, int width, int height, int bsize,
+		int x, int y, int rw, int rh, void *dst)
+{
+	int bx, by, run;
+	int bw = (width + 3) / 4;
+	int bh = (height + 3) / 4;
+	int bx0 = x / 4, by0 = y / 4;
+	int bx1, by1;
+	unsigned char *dptr = dst;
+	const unsigned char *sptr = src;
+
+	if(x < 0 || y < 0 || rw <= 0 || rh <= 0 || (x & 3) || (y & 3) ||
+			rw > width - x || rh > height - y) {
+		return -1;
+	}
+	bx1 = (x + rw + 3) / 4;
+	by1 = (y + rh + 3) / 4;
+
+	for(by=by0; by<by1; by++) {
+		for(bx=bx0; bx<bx1; bx+=run) {
+			int idx = block_index(layout, bx, by, bw, bh, &run);
+			if(run > bx1 - bx) run = bx1 - bx;
+
+			memcpy(dptr, sptr + idx * bsize, run * bsize);
+			dptr += run * bsize;
+		}
+	}
+	return 0;
+}
+
+/* copy two consecutive blocks */
+static inline void copy_pair(unsigned char *dst, const unsigned char *src, int bsize)
+{
+#ifdef __SSE2__
+	if(bsize == 8) {
+		_mm_storeu_si128((__m128i*)dst, _mm_loadu_si128((const __m128i*)src));
+	} else {
+		__m128i a = _mm_loadu_si128((const __m128i*)src);
+		__m128i b = _mm_loadu_si128((const __m128i*)(src + 16));
+		_mm_storeu_si128((__m128i*)dst, a);
+		_mm_storeu_si128((__m128i*)(dst + 16), b);
+	}
+#else
+	memcpy(dst, src, bsize * 2);
+#endif
+}
+
+/* move blocks between the linear level lin and the swizzled level sw, in
+ * the direction given by to_layout
+ */
+static void reorder(int layout, unsigned char *lin, unsigned char *sw, int width, int height,
+		int bsize, int to_layout)
+{
+	int tx, ty, tw, th, r, c;
+	int bw = (width + 3) / 4;
+	int bh = (height + 3) / 4;
+	size_t pitch = (size_t)bw * bsize;
+	unsigned char *tile, *lrow;
+
+	if(layout == LAYOUT_LINEAR) {
+		if(to_layout) {
+			memcpy(sw, lin, pitch * bh);
+		} else {
+			memcpy(lin, sw, pitch * bh);
+		}
+		return;
+	}
+
+	for(ty=0; ty<bh; ty+=T) {
+		th = bh - ty < T ? bh - ty : T;
+
+		for(tx=0; tx<bw; tx+=T) {
+			tw = bw - tx < T ? bw - tx : T;
+			tile = sw + ((size_t)ty * bw + (size_t)tx * th) * bsize;
+
+			if(layout == LAYOUT_MORTON && tw == T && th == T) {
+				for(r=0; r<T; r++) {
+					lrow = lin + (ty + r) * pitch + tx * bsize;
+					for(c=0; c<T; c+=2) {
+						unsigned char *tptr = tile + morton[r][c] * bsize;
+						if(to_layout) {
+							copy_pair(tptr, lrow + c * bsize, bsize);
+						} else {
+							copy_pair(lrow + c * bsize, tptr, bsize);
+						}
+					}
+				}
+			} else {
+				for(r=0; r<th; r++) {
+					lrow = lin + (ty + r) * pitch + tx * bsize;
+					if(to_layout) {
+						memcpy(tile + r * tw * bsize, lrow, tw * bsize);
+					} else {
+						memcpy(lrow, tile + r * tw * bsize, tw * bsize);
+					}
+				}
+			}
+		}
+	}
+}
+
+/* index of block bx, by in layout. run is set to the number of blocks of
+ * the same row stored contiguously from that one on.
+ */
+static int block_index(int layout, int bx, int by, int bw, int bh, int *run)
+{
+	int tx, ty, tw, th, base;
+
+	if(layout == LAYOUT_LINEAR) {
+		*run = bw - bx;
+		return by * bw + bx;
+	}
+
+	tx = bx - bx % T;
+	ty = by - by % T;
+	tw = bw - tx < T ? bw - tx : T;
+	th = bh - ty < T ? bh - ty : T;
+	base = ty * bw + tx * th;
+
+	if(layout == LAYOUT_MORTON && tw == T && th == T) {
+		*run = bx & 1 ? 1 : 2;
+		return base + morton[by - ty][bx - tx];
+	}
+	*run = tx + tw - bx;
+	return base + (by - ty) * tw + bx - tx;
+}
@@ -0,0 +1,38 @@
+#ifndef SWIZZLE_H_
+#define SWIZZLE_H_
+
+#include "comptex.h"
+
+/* block orders for the levels of block-compressed textures. Blocks are
+ * grouped in tiles of LAYOUT_TILE x LAYOUT_TILE blocks, stored row by row;
+ * the blocks of a tile are stored in row-major order (tiled), or in Z-order
+ * (morton). Tiles cut short by the edge of the level are always row-major,
+ * so no padding is needed and the level size stays the same.
+ */
+
+enum {
+	LAYOUT_LINEAR = COMPTEX_ORDER_LINEAR,
+	LAYOUT_TILED = COMPTEX_ORDER_TILED,
+	LAYOUT_MORTON = COMPTEX_ORDER_MORTON,
+	NUM_LAYOUTS
+};
+
+#define LAYOUT_TILE		COMPTEX_TILE_BLOCKS
+
+const char *layout_name(int layout);
+int layout_from_name(const char *name);	/* -1 if unknown */
+
+/* reorder the blocks of a width x height level from linear to layout, and
+ * back. bsize is the size of a block in bytes (8 or 16).
+ */
+void swizzle_level(int layout, const void *src, void *dst, int width, int height, int bsize);
+void unswizzle_level(int layout, const void *src, void *dst, int width, int height, int bsize);
+
+/* copy the blocks covering the rw x rh pixel region at x, y of a level in
+ * layout into dst, in linear order. The region must be block-aligned, and
+ * inside the level, or nothing is copied and -1 is returned.
+ */
+int extract_region(int layout, const void *src, int width, int height, int bsize,
+		int x, int y, int rw, int rh, void *dst);
+
+#endif	/* SWIZZLE_H_ */
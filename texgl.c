@@ -0,0 +1,146 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <GL/glew.h>
+#include "texgl.h"
+#include "transcode.h"
+#include "swizzle.h"
+
+unsigned int upload_comptex(const struct comptex *ct, int base_level)
+{
+	int i;
+	unsigned int id;
+	unsigned char *lin = 0, *data;
+
+	if(base_level >= ct->levels || !ct->data[base_level]) {
+		return 0;
+	}
+	if(ct->layout != LAYOUT_LINEAR && !(lin = malloc(ct->size[base_level]))) {
+		fprintf(stderr, "failed to allocate unswizzling buffer (%u bytes)\n", ct->size[base_level]);
+		return 0;
+	}
+
+	glGenTextures(1, &id);
+	glBindTexture(GL_TEXTURE_2D, id);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+			ct->levels - base_level > 1 ? GL_NEAREST_MIPMAP_NEAREST : GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, ct->levels - base_level - 1);
+
+	for(i=base_level; i<ct->levels; i++) {
+		if(!ct->data[i]) {
+			continue;
+		}
+		if(lin) {
+			comptex_linear_level(ct, i, lin);
+			data = lin;
+		} else {
+			data = ct->data[i];
+		}
+
+		if(transcode_is_uncompressed(ct->fmt)) {
+			glTexImage2D(GL_TEXTURE_2D, i - base_level, ct->fmt, comptex_level_width(ct, i),
+					comptex_level_height(ct, i), 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+		} else {
+			glCompressedTexImage2D(GL_TEXTURE_2D, i - base_level, ct->fmt,
+					comptex_level_width(ct, i), comptex_level_height(ct, i), 0,
+					ct->size[i], data);
+		}
+	}
+	free(lin);
+	return id;
+}
+
+unsigned int upload_comptex_file(const struct comptex_file *cf, int base_level)
+{
+	int i;
+	struct comptex ct;
+	struct comptex_info info;
+	struct comptex_level lvl;
+
+	comptex_get_info(cf, &info);
+
+	memset(&ct, 0, sizeof ct);
+	ct.fmt = ct.srcfmt = info.glfmt;
+	ct.width = info.width;
+	ct.height = info.height;
+	ct.levels = info.levels;
+	ct.layout = info.layout;
+	for(i=0; i<info.levels; i++) {
+		if(comptex_get_level(cf, i, &lvl) != -1) {
+			ct.size[i] = lvl.size;
+			ct.data[i] = (unsigned char*)lvl.data;
+		}
+	}
+	return upload_comptex(&ct, base_level);
+}
+
+int load_texture(struct comptex_ctx *ctx, const char *fname, struct texture *tex)
+{
+	struct comptex ct;
+
+	if(read_comptex(ctx, fname, &ct) == -1) {
+		return -1;
+	}
+
+	tex->fmt = ct.fmt;
+	tex->srcfmt = ct.srcfmt;
+	tex->width = ct.width;
+	tex->height = ct.height;
+	tex->compsize = ct.size[0];
+	tex->hash = ct.hash;
+	tex->layout = ct.layout;
+
+	if(!(tex->data = malloc(tex->compsize))) {
+		fprintf(stderr, "failed to allocate data buffer\n");
+		free_comptex(&ct);
+		return -1;
+	}
+	comptex_linear_level(&ct, 0, tex->data);
+
+	if(!(tex->id = upload_comptex(&ct, 0))) {
+		free(tex->data);
+		free_comptex(&ct);
+		return -1;
+	}
+
+	printf("%s: %dx%d format: %s\n", fname, tex->width, tex->height, fmtstr(tex->fmt));
+	if(tex->layout != LAYOUT_LINEAR) {
+		printf("%s: %s block order\n", fname, layout_name(tex->layout));
+	}
+
+	free_comptex(&ct);
+	return 0;
+}
+
+void print_compressed_formats(struct comptex_ctx *ctx)
+{
+	int i, num_fmt;
+	int *fmtlist;
+
+	glGetIntegerv(GL_NUM_COMPRESSED_TEXTURE_FORMATS, &num_fmt);
+	printf("%d generic compressed texture formats available:\n", num_fmt);
+
+	if(!(fmtlist = malloc(num_fmt * sizeof *fmtlist))) {
+		fprintf(stderr, "failed to allocate texture formats enumeration buffer\n");
+		return;
+	}
+	glGetIntegerv(GL_COMPRESSED_TEXTURE_FORMATS, fmtlist);
+
+	for(i=0; i<num_fmt; i++) {
+		printf(" %05x: %s ", fmtlist[i], fmtstr(fmtlist[i]));
+		GLint params;
+		glGetInternalformativ(GL_TEXTURE_2D, fmtlist[i], GL_TEXTURE_COMPRESSED, 1, &params);
+		printf("(%s format)\n", params == GL_TRUE ? "compressed" : "not compressed");
+	}
+
+	/* keep the list in the context, load_texture checks it before uploading */
+	comptex_set_formats(ctx, fmtlist, num_fmt);
+	free(fmtlist);
+}
+
+void calc_fingerprints(struct comptex_ctx *ctx)
+{
+	comptex_set_driver(ctx, (const char*)glGetString(GL_RENDERER),
+			(const char*)glGetString(GL_VERSION));
+}
@@ -0,0 +1,41 @@
+#ifndef TEXGL_H_
+#define TEXGL_H_
+
+#include "texture.h"
+#include "comptex.h"
+
+/* GL layer of libcomptex: uploads host textures, and fills in the driver's
+ * compressed format list the loader transcodes against in a context
+ */
+
+struct texture {
+	unsigned int id;
+	int width, height;
+	unsigned int fmt;
+	unsigned int srcfmt;	/* format in the file, differs from fmt if transcoded */
+	unsigned int compsize;
+	void *data;		/* level 0, always in linear block order */
+	int layout;		/* block order in the file */
+	uint64_t hash;	/* content hash of the file, 0 if the cache is disabled */
+};
+
+/* create a GL texture out of the levels of ct starting from base_level,
+ * returns the texture name, or 0 on failure. The created texture is left
+ * bound.
+ */
+unsigned int upload_comptex(const struct comptex *ct, int base_level);
+
+/* same for an opened or loaded file, uploading straight from its levels.
+ * Nothing is transcoded here, so an opened file has to be in a format the
+ * driver takes; comptex_load takes care of that.
+ */
+unsigned int upload_comptex_file(const struct comptex_file *cf, int base_level);
+
+int load_texture(struct comptex_ctx *ctx, const char *fname, struct texture *tex);
+
+/* query the compressed formats of the current GL context into ctx */
+void print_compressed_formats(struct comptex_ctx *ctx);
+/* identify the driver of the current GL context in ctx */
+void calc_fingerprints(struct comptex_ctx *ctx);
+
+#endif	/* TEXGL_H_ */
@@ -0,0 +1,309 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <GL/glew.h>
+#include "texman.h"
+#include "texgl.h"
+
+static void lru_remove(struct managed_tex *mt, int which);
+static void lru_push_front(struct managed_tex *mt, int which);
+static void make_gpu_room(struct managed_tex *keep, size_t need);
+static void trim_host(struct managed_tex *keep);
+static int demote(struct managed_tex *mt);
+static void evict_gpu(struct managed_tex *mt);
+static void drop_host(struct managed_tex *mt);
+static size_t levels_size(const struct comptex *ct, int base);
+
+static struct managed_tex *head[2], *tail[2];
+static int count[2];
+static size_t budget[2];
+
+static struct managed_tex **texlist;
+static int num_tex, max_tex;
+
+static struct texman_stats stats;
+static struct comptex_ctx *ctx;
+
+
+void texman_init(struct comptex_ctx *loader_ctx, size_t host_budget, size_t gpu_budget)
+{
+	ctx = loader_ctx;
+	budget[LRU_HOST] = host_budget;
+	budget[LRU_GPU] = gpu_budget;
+	memset(&stats, 0, sizeof stats);
+}
+
+void texman_destroy(void)
+{
+	int i;
+
+	for(i=0; i<num_tex; i++) {
+		struct managed_tex *mt = texlist[i];
+
+		if(mt->id) {
+			glDeleteTextures(1, &mt->id);
+		}
+		free_comptex(&mt->ct);
+		free(mt->fname);
+		free(mt);
+	}
+	free(texlist);
+	texlist = 0;
+	num_tex = max_tex = 0;
+
+	head[0] = head[1] = tail[0] = tail[1] = 0;
+	count[0] = count[1] = 0;
+	memset(&stats, 0, sizeof stats);
+}
+
+struct managed_tex *texman_add(const char *fname)
+{
+	struct managed_tex *mt, **tmp;
+
+	if(num_tex >= max_tex) {
+		int newmax = max_tex ? max_tex * 2 : 64;
+		if(!(tmp = realloc(texlist, newmax * sizeof *texlist))) {
+			fprintf(stderr, "failed to resize texture manager list\n");
+			return 0;
+		}
+		texlist = tmp;
+		max_tex = newmax;
+	}
+
+	if(!(mt = calloc(1, sizeof *mt)) || !(mt->fname = malloc(strlen(fname) + 1))) {
+		fprintf(stderr, "failed to allocate managed texture\n");
+		free(mt);
+		return 0;
+	}
+	strcpy(mt->fname, fname);
+
+	texlist[num_tex++] = mt;
+	return mt;
+}
+
+int texman_use(struct managed_tex *mt)
+{
+	double t0, dt;
+
+	stats.uses++;
+	if(mt->id && mt->base == 0) {
+		stats.hits++;
+		lru_remove(mt, LRU_GPU);
+		lru_push_front(mt, LRU_GPU);
+		if(mt->ct.mem) {
+			lru_remove(mt, LRU_HOST);
+			lru_push_front(mt, LRU_HOST);
+		}
+		return 0;
+	}
+
+	t0 = get_msec();
+
+	if(mt->ct.mem) {
+		stats.host_hits++;
+		lru_remove(mt, LRU_HOST);
+	} else {
+		if(read_comptex(ctx, mt->fname, &mt->ct) == -1) {
+			return -1;
+		}
+		stats.reloads++;
+		stats.host_used += mt->ct.memsize;
+	}
+	lru_push_front(mt, LRU_HOST);
+
+	make_gpu_room(mt, levels_size(&mt->ct, 0) - mt->gpu_bytes);
+
+	/* demoted textures are re-created at full detail */
+	if(mt->id) {
+		glDeleteTextures(1, &mt->id);
+		lru_remove(mt, LRU_GPU);
+		stats.gpu_used -= mt->gpu_bytes;
+		mt->gpu_bytes = 0;
+	}
+	if(!(mt->id = upload_comptex(&mt->ct, 0))) {
+		return -1;
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	mt->base = 0;
+	mt->gpu_bytes = levels_size(&mt->ct, 0);
+	stats.gpu_used += mt->gpu_bytes;
+	lru_push_front(mt, LRU_GPU);
+
+	trim_host(mt);
+
+	dt = get_msec() - t0;
+	stats.reload_msec += dt;
+	if(dt > stats.max_reload_msec) {
+		stats.max_reload_msec = dt;
+	}
+	return 0;
+}
+
+void texman_get_stats(struct texman_stats *st)
+{
+	*st = stats;
+}
+
+void texman_print_stats(FILE *fp)
+{
+	unsigned long misses = stats.uses - stats.hits;
+
+	fprintf(fp, "texture manager: %lu uses, %.2f%% hit rate, %lu host hits, %lu disk reloads\n",
+			stats.uses, stats.uses ? 100.0 * stats.hits / stats.uses : 0.0,
+			stats.host_hits, stats.reloads);
+	fprintf(fp, "  %lu demotions, %lu evictions, %lu host evictions\n", stats.demotions,
+			stats.evictions, stats.host_evictions);
+	fprintf(fp, "  reload latency: %.3f ms avg, %.3f ms max\n",
+			misses ? stats.reload_msec / misses : 0.0, stats.max_reload_msec);
+	fprintf(fp, "  gpu: %lu/%lu KB, host: %lu/%lu KB\n",
+			(unsigned long)(stats.gpu_used >> 10), (unsigned long)(budget[LRU_GPU] >> 10),
+			(unsigned long)(stats.host_used >> 10), (unsigned long)(budget[LRU_HOST] >> 10));
+}
+
+static void lru_remove(struct managed_tex *mt, int which)
+{
+	struct managed_tex *prev = mt->link[which].prev;
+	struct managed_tex *next = mt->link[which].next;
+
+	if(prev) {
+		prev->link[which].next = next;
+	} else if(head[which] == mt) {
+		head[which] = next;
+	} else {
+		return;		/* not in the list */
+	}
+	if(next) {
+		next->link[which].prev = prev;
+	} else {
+		tail[which] = prev;
+	}
+	mt->link[which].prev = mt->link[which].next = 0;
+	count[which]--;
+}
+
+static void lru_push_front(struct managed_tex *mt, int which)
+{
+	mt->link[which].prev = 0;
+	mt->link[which].next = head[which];
+	if(head[which]) {
+		head[which]->link[which].prev = mt;
+	} else {
+		tail[which] = mt;
+	}
+	head[which] = mt;
+	count[which]++;
+}
+
+/* free GPU memory for need more bytes. The least recently used half of the
+ * resident textures first lose their finest level, and if that's not enough
+ * textures are evicted entirely, least recently used first.
+ */
+static void make_gpu_room(struct managed_tex *keep, size_t need)
+{
+	int i, n;
+	struct managed_tex *mt, *prev;
+
+	n = count[LRU_GPU] / 2;
+	mt = tail[LRU_GPU];
+	for(i=0; mt && i<n && stats.gpu_used + need > budget[LRU_GPU]; i++) {
+		prev = mt->link[LRU_GPU].prev;
+		if(mt != keep) {
+			demote(mt);
+		}
+		mt = prev;
+	}
+
+	mt = tail[LRU_GPU];
+	while(mt && stats.gpu_used + need > budget[LRU_GPU]) {
+		prev = mt->link[LRU_GPU].prev;
+		if(mt != keep) {
+			evict_gpu(mt);
+		}
+		mt = prev;
+	}
+}
+
+static void trim_host(struct managed_tex *keep)
+{
+	struct managed_tex *mt, *prev;
+
+	mt = tail[LRU_HOST];
+	while(mt && stats.host_used > budget[LRU_HOST]) {
+		prev = mt->link[LRU_HOST].prev;
+		if(mt != keep) {
+			drop_host(mt);
+		}
+		mt = prev;
+	}
+}
+
+/* replace the texture with one lacking its finest level. The remaining
+ * levels are copied on the GPU, so this works without a host copy.
+ */
+static int demote(struct managed_tex *mt)
+{
+	int i, base = mt->base + 1;
+	unsigned int id;
+	struct comptex *ct = &mt->ct;
+
+	if(base >= ct->levels || !ct->size[base]) {
+		return -1;
+	}
+
+	glGenTextures(1, &id);
+	glBindTexture(GL_TEXTURE_2D, id);
+	glTexStorage2D(GL_TEXTURE_2D, ct->levels - base, ct->fmt, comptex_level_width(ct, base),
+			comptex_level_height(ct, base));
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+			ct->levels - base > 1 ? GL_NEAREST_MIPMAP_NEAREST : GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	for(i=base; i<ct->levels; i++) {
+		if(!ct->size[i]) continue;
+
+		glCopyImageSubData(mt->id, GL_TEXTURE_2D, i - mt->base, 0, 0, 0,
+				id, GL_TEXTURE_2D, i - base, 0, 0, 0,
+				comptex_level_width(ct, i), comptex_level_height(ct, i), 1);
+	}
+	glDeleteTextures(1, &mt->id);
+
+	stats.gpu_used -= mt->gpu_bytes;
+	mt->id = id;
+	mt->base = base;
+	mt->gpu_bytes = levels_size(ct, base);
+	stats.gpu_used += mt->gpu_bytes;
+	stats.demotions++;
+	return 0;
+}
+
+static void evict_gpu(struct managed_tex *mt)
+{
+	glDeleteTextures(1, &mt->id);
+	mt->id = 0;
+	lru_remove(mt, LRU_GPU);
+
+	stats.gpu_used -= mt->gpu_bytes;
+	mt->gpu_bytes = 0;
+	stats.evictions++;
+}
+
+static void drop_host(struct managed_tex *mt)
+{
+	stats.host_used -= mt->ct.memsize;
+	free_comptex(&mt->ct);
+	lru_remove(mt, LRU_HOST);
+	stats.host_evictions++;
+}
+
+static size_t levels_size(const struct comptex *ct, int base)
+{
+	int i;
+	size_t sz = 0;
+
+	for(i=base; i<ct->levels; i++) {
+		sz += ct->size[i];
+	}
+	return sz;
+}
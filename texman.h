@@ -0,0 +1,51 @@
+#ifndef TEXMAN_H_
+#define TEXMAN_H_
+
+#include <stdio.h>
+#include "texture.h"
+
+enum { LRU_GPU, LRU_HOST };
+
+/* a texture file under the control of the texture manager */
+struct managed_tex {
+	char *fname;
+	struct comptex ct;	/* ct.mem is 0 while there's no host copy */
+
+	unsigned int id;	/* GL texture, 0 if not resident on the GPU */
+	int base;			/* finest file level resident on the GPU */
+	size_t gpu_bytes;
+
+	/* links in the GPU and host LRU lists, most recently used first */
+	struct {
+		struct managed_tex *prev, *next;
+	} link[2];
+};
+
+struct texman_stats {
+	unsigned long uses;
+	unsigned long hits;				/* fully resident on the GPU when used */
+	unsigned long host_hits;		/* uploaded from the host copy */
+	unsigned long reloads;			/* had to be read from disk */
+	unsigned long demotions;		/* finest level dropped from the GPU */
+	unsigned long evictions;		/* dropped from the GPU entirely */
+	unsigned long host_evictions;	/* host copy dropped */
+	double reload_msec, max_reload_msec;	/* time to make non-resident textures resident */
+	size_t gpu_used, host_used;
+};
+
+/* textures are loaded through ctx */
+void texman_init(struct comptex_ctx *ctx, size_t host_budget, size_t gpu_budget);
+void texman_destroy(void);
+
+/* register a file with the manager, it is not loaded until first used */
+struct managed_tex *texman_add(const char *fname);
+
+/* make mt fully resident on the GPU, loading it if necessary, and mark it
+ * as the most recently used. Returns -1 if it could not be loaded.
+ */
+int texman_use(struct managed_tex *mt);
+
+void texman_get_stats(struct texman_stats *st);
+void texman_print_stats(FILE *fp);
+
+#endif	/* TEXMAN_H_ */
@@ -0,0 +1,711 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "texture.h"
+#include "transcode.h"
+#include "cache.h"
+#include "aio.h"
+#include "import.h"
+#include "swizzle.h"
+
+/* header of a cached set of transcoded levels, followed by the level data */
+struct tc_cache_hdr {
+	char magic[8];
+	uint32_t glfmt;
+	uint32_t levels;
+	uint32_t size[MAX_LEVELS];
+};
+
+static int check_header(const char *fname, const struct comptex_header *hdr);
+static size_t payload_size(const struct comptex_header *hdr);
+static int setup_comptex(struct comptex_ctx *ctx, const char *fname, struct comptex *ct,
+		const struct comptex_header *hdr, unsigned char *payload, size_t paysize);
+static int transcode_comptex(struct comptex_ctx *ctx, const char *fname, struct comptex *ct,
+		const unsigned char *payload);
+
+
+int read_comptex(struct comptex_ctx *ctx, const char *fname, struct comptex *ct)
+{
+	FILE *fp;
+	struct comptex_header hdr;
+	struct import_info inf;
+	int i;
+	struct stat st;
+	unsigned char *buf, *ptr;
+	size_t paysize, rd;
+
+	if(!(fp = fopen(fname, "rb"))) {
+		fprintf(stderr, "failed to open file: %s: %s\n", fname, strerror(errno));
+		return -1;
+	}
+	rd = fread(&hdr, 1, sizeof hdr, fp);
+
+	if(import_probe(&hdr, rd) != IMPORT_COMPTEX) {
+		/* DDS, KTX or legacy, read the levels wherever the container has them
+		 * into the same packed layout a COMPTEX0 file would have
+		 */
+		if(import_open(fname, fp, &inf) == -1) {
+			fclose(fp);
+			return -1;
+		}
+		import_comptex_header(&inf, &hdr);
+		paysize = payload_size(&hdr);
+
+		if(!(buf = malloc(paysize))) {
+			fprintf(stderr, "failed to allocate compressed texture buffer (%d bytes): %s\n",
+					(int)paysize, strerror(errno));
+			fclose(fp);
+			return -1;
+		}
+		if(import_read(fname, fp, &inf, buf) == -1) {
+			fclose(fp);
+			free(buf);
+			return -1;
+		}
+		fclose(fp);
+
+	} else {
+		if(rd != sizeof hdr) {
+			fprintf(stderr, "failed to read image file header: %s: %s\n", fname, strerror(errno));
+			fclose(fp);
+			return -1;
+		}
+		if(check_header(fname, &hdr) == -1) {
+			fclose(fp);
+			return -1;
+		}
+
+		/* read every level from where the header says it is, packed one
+		 * after the other, the same way read_comptex_batch does
+		 */
+		fstat(fileno(fp), &st);
+		for(i=0; i<hdr.levels; i++) {
+			if(sizeof hdr + (off_t)hdr.datadesc[i].offset + hdr.datadesc[i].size > st.st_size) {
+				fprintf(stderr, "unexpected EOF while reading texture: %s\n", fname);
+				fclose(fp);
+				return -1;
+			}
+		}
+		paysize = payload_size(&hdr);
+
+		if(!(buf = malloc(paysize))) {
+			fprintf(stderr, "failed to allocate compressed texture buffer (%d bytes): %s\n",
+					(int)paysize, strerror(errno));
+			fclose(fp);
+			return -1;
+		}
+		ptr = buf;
+		for(i=0; i<hdr.levels; i++) {
+			if(!hdr.datadesc[i].size) continue;
+
+			if(fseek(fp, sizeof hdr + hdr.datadesc[i].offset, SEEK_SET) == -1 ||
+					fread(ptr, 1, hdr.datadesc[i].size, fp) != hdr.datadesc[i].size) {
+				fprintf(stderr, "unexpected EOF while reading texture: %s\n", fname);
+				fclose(fp);
+				free(buf);
+				return -1;
+			}
+			ptr += hdr.datadesc[i].size;
+		}
+		fclose(fp);
+	}
+
+	if(setup_comptex(ctx, fname, ct, &hdr, buf, paysize) == -1) {
+		free(buf);
+		return -1;
+	}
+	if(ct->mem) {
+		free(buf);	/* transcoded */
+	} else {
+		ct->mem = buf;
+		ct->memsize = paysize;
+	}
+	return 0;
+}
+
+/* files are read in groups of BATCH_FILES: all headers first, then all the
+ * levels of the group into one arena, keeping up to BATCH_DEPTH reads in flight
+ */
+#define BATCH_FILES	128
+#define BATCH_DEPTH	64
+
+struct batch_file {
+	int fd;
+	unsigned char *payload;
+	size_t paysize;
+	int pending;	/* level reads still in flight */
+	int failed;
+	int import;		/* not a COMPTEX0 file, loaded through the importers */
+};
+
+int read_comptex_batch(struct comptex_ctx *ctx, const char **fnames, int num, int backend,
+		comptex_func done, void *cls, struct batch_stats *bst)
+{
+	int i, j, n, first, fixed;
+	struct aio *aio;
+	struct aio_req *hreq, *lreq, *req;
+	struct comptex_header *hdrs;
+	struct batch_file *files, *bf;
+	struct comptex ct;
+	struct iovec iov[2];
+	unsigned char *arena = 0, *ptr;
+	size_t arena_size = 0, total;
+	double t0, tcb;
+
+	memset(bst, 0, sizeof *bst);
+
+	if(!(aio = aio_open(backend, BATCH_DEPTH))) {
+		fprintf(stderr, "asynchronous I/O backend not available: %s\n", aio_backend_name(backend));
+		return -1;
+	}
+	bst->backend = aio_backend(aio);
+
+	hdrs = malloc(BATCH_FILES * sizeof *hdrs);
+	files = malloc(BATCH_FILES * sizeof *files);
+	hreq = malloc(BATCH_FILES * sizeof *hreq);
+	lreq = malloc(BATCH_FILES * MAX_LEVELS * sizeof *lreq);
+	if(!hdrs || !files || !hreq || !lreq) {
+		fprintf(stderr, "failed to allocate batch loader state\n");
+		free(hdrs);
+		free(files);
+		free(hreq);
+		free(lreq);
+		aio_close(aio);
+		return -1;
+	}
+
+	t0 = get_msec();
+
+	for(first=0; first<num; first+=BATCH_FILES) {
+		n = num - first < BATCH_FILES ? num - first : BATCH_FILES;
+
+		/* headers */
+		iov[0].iov_base = hdrs;
+		iov[0].iov_len = n * sizeof *hdrs;
+		fixed = aio_register_buffers(aio, iov, 1) != -1;
+
+		for(i=0; i<n; i++) {
+			bf = files + i;
+			memset(bf, 0, sizeof *bf);
+			if((bf->fd = open(fnames[first + i], O_RDONLY)) == -1) {
+				fprintf(stderr, "failed to open file: %s: %s\n", fnames[first + i], strerror(errno));
+				bf->failed = 1;
+				continue;
+			}
+			hreq[i].fd = bf->fd;
+			hreq[i].offset = 0;
+			hreq[i].buf = hdrs + i;
+			hreq[i].size = sizeof *hdrs;
+			hreq[i].buf_index = fixed ? 0 : -1;
+			hreq[i].udata = bf;
+			aio_submit(aio, hreq + i);
+		}
+
+		total = 0;
+		while((req = aio_wait(aio))) {
+			bf = req->udata;
+			i = bf - files;
+			bst->reads++;
+			if(req->result >= 0 && import_probe(hdrs + i, req->result) != IMPORT_COMPTEX) {
+				bf->import = 1;
+				continue;
+			}
+			if(req->result != sizeof *hdrs) {
+				fprintf(stderr, "failed to read image file header: %s: %s\n", fnames[first + i],
+						req->result < 0 ? strerror(-req->result) : "unexpected EOF");
+				bf->failed = 1;
+				continue;
+			}
+			bst->bytes += req->result;
+			if(check_header(fnames[first + i], hdrs + i) == -1) {
+				bf->failed = 1;
+				continue;
+			}
+			bf->paysize = payload_size(hdrs + i);
+			total += bf->paysize;
+		}
+
+		/* levels, each one read from where the header says it is */
+		if(total > arena_size) {
+			free(arena);
+			if(!(arena = malloc(total))) {
+				fprintf(stderr, "failed to allocate batch arena (%lu bytes)\n", (unsigned long)total);
+				arena_size = 0;
+				for(i=0; i<n; i++) {
+					if(files[i].fd != -1) close(files[i].fd);
+				}
+				bst->failed += n;
+				continue;
+			}
+			arena_size = total;
+		}
+		iov[1].iov_base = arena;
+		iov[1].iov_len = total;
+		fixed = total && aio_register_buffers(aio, iov, 2) != -1;
+
+		ptr = arena;
+		for(i=0; i<n; i++) {
+			bf = files + i;
+			if(bf->failed || bf->import) continue;
+
+			bf->payload = ptr;
+			for(j=0; j<hdrs[i].levels; j++) {
+				if(!hdrs[i].datadesc[j].size) continue;
+
+				req = lreq + i * MAX_LEVELS + j;
+				req->fd = bf->fd;
+				req->offset = sizeof *hdrs + hdrs[i].datadesc[j].offset;
+				req->buf = ptr;
+				req->size = hdrs[i].datadesc[j].size;
+				req->buf_index = fixed ? 1 : -1;
+				req->udata = bf;
+				aio_submit(aio, req);
+
+				ptr += req->size;
+				bf->pending++;
+			}
+		}
+
+		while((req = aio_wait(aio))) {
+			bf = req->udata;
+			i = bf - files;
+			bst->reads++;
+			if(req->result > 0) {
+				bst->bytes += req->result;
+			}
+			if(req->result != (ssize_t)req->size && !bf->failed) {
+				fprintf(stderr, "failed to read texture: %s: %s\n", fnames[first + i],
+						req->result < 0 ? strerror(-req->result) : "unexpected EOF");
+				bf->failed = 1;
+			}
+			if(--bf->pending > 0 || bf->failed) continue;
+
+			tcb = get_msec();
+			if(setup_comptex(ctx, fnames[first + i], &ct, hdrs + i, bf->payload,
+						bf->paysize) != -1) {
+				done(first + i, &ct, cls);
+				bst->files++;
+			} else {
+				bf->failed = 1;
+			}
+			bst->cb_msec += get_msec() - tcb;
+		}
+
+		/* other containers are rare enough to just load them synchronously */
+		for(i=0; i<n; i++) {
+			if(!files[i].import) continue;
+
+			if(read_comptex(ctx, fnames[first + i], &ct) == -1) {
+				files[i].failed = 1;
+				continue;
+			}
+			tcb = get_msec();
+			done(first + i, &ct, cls);
+			bst->cb_msec += get_msec() - tcb;
+			bst->files++;
+		}
+
+		for(i=0; i<n; i++) {
+			if(files[i].fd != -1) {
+				close(files[i].fd);
+			}
+			if(files[i].failed) {
+				bst->failed++;
+			}
+		}
+	}
+
+	bst->msec = get_msec() - t0;
+
+	aio_close(aio);
+	free(arena);
+	free(hdrs);
+	free(files);
+	free(hreq);
+	free(lreq);
+	return bst->failed ? -1 : 0;
+}
+
+static int check_header(const char *fname, const struct comptex_header *hdr)
+{
+	if(memcmp(hdr->magic, "COMPTEX0", sizeof hdr->magic) != 0 ||
+			hdr->levels > MAX_LEVELS || !hdr->datadesc[0].size) {
+		fprintf(stderr, "%s is not a compressed texture file, or is corrupted\n", fname);
+		return -1;
+	}
+	if(COMPTEX_LAYOUT(hdr->flags) >= NUM_LAYOUTS ||
+			(COMPTEX_LAYOUT(hdr->flags) != LAYOUT_LINEAR && !transcode_block_size(hdr->glfmt))) {
+		fprintf(stderr, "%s: unsupported block layout (flags: %x)\n", fname, (unsigned int)hdr->flags);
+		return -1;
+	}
+	return 0;
+}
+
+static size_t payload_size(const struct comptex_header *hdr)
+{
+	int i;
+	size_t sz = 0;
+
+	for(i=0; i<hdr->levels; i++) {
+		sz += hdr->datadesc[i].size;
+	}
+	return sz;
+}
+
+/* fill in ct from the header and the packed level data in payload. ct->mem
+ * is left 0, unless the levels had to be transcoded into new memory.
+ */
+static int setup_comptex(struct comptex_ctx *ctx, const char *fname, struct comptex *ct,
+		const struct comptex_header *hdr, unsigned char *payload, size_t paysize)
+{
+	int i;
+	unsigned char *ptr;
+
+	memset(ct, 0, sizeof *ct);
+	ct->fmt = ct->srcfmt = hdr->glfmt;
+	ct->width = hdr->width;
+	ct->height = hdr->height;
+	ct->levels = hdr->levels;
+	ct->layout = COMPTEX_LAYOUT(hdr->flags);
+
+	ptr = payload;
+	for(i=0; i<hdr->levels; i++) {
+		if(check_level_size(fname, hdr->glfmt, hdr->width, hdr->height, i,
+					hdr->datadesc[i].size) == -1) {
+			return -1;
+		}
+		if((ct->size[i] = hdr->datadesc[i].size)) {
+			ct->data[i] = ptr;
+			ptr += ct->size[i];
+		}
+	}
+
+	if(ctx->cache) {
+		ct->hash = cache_hash(payload, paysize, cache_hash(hdr, sizeof *hdr, 0));
+	}
+
+	/* uncompressed levels go to GL as they are. The block orders only make
+	 * sense for 4x4 blocks.
+	 */
+	if(transcode_is_uncompressed(hdr->glfmt)) {
+		if(ct->layout != LAYOUT_LINEAR) {
+			fprintf(stderr, "%s: %s levels must be in linear order\n", fname, fmtstr(hdr->glfmt));
+			return -1;
+		}
+		return 0;
+	}
+
+	/* if the driver can't take the format in the file, transcode it on the
+	 * CPU to the best format it does support
+	 */
+	if(!fmt_supported(ctx, hdr->glfmt)) {
+		if(transcode_comptex(ctx, fname, ct, payload) == -1) {
+			return -1;
+		}
+	}
+	return 0;
+}
+
+static int transcode_comptex(struct comptex_ctx *ctx, const char *fname, struct comptex *ct,
+		const unsigned char *payload)
+{
+	int i, badsize;
+	unsigned int dstfmt;
+	struct tc_cache_hdr *tchdr;
+	unsigned char *dst, *lin = 0;
+	size_t pos, tcsize, mapsize;
+	double t0, tc_msec = 0, tc_mpix = 0;
+	uint64_t key = 0;
+
+	if(!(dstfmt = transcode_target(ct->srcfmt, ctx->fmt, ctx->num_fmt))) {
+		fprintf(stderr, "%s: format %s [%x] is not supported by the driver, and there's "
+				"no CPU fallback for it\n", fname, fmtstr(ct->srcfmt), ct->srcfmt);
+		return -1;
+	}
+	printf("%s: format %s is not supported, transcoding to %s\n", fname,
+			fmtstr(ct->srcfmt), fmtstr(dstfmt));
+
+	if(ct->hash) {
+		key = cache_hash(&ctx->fmt_fingerprint, sizeof ctx->fmt_fingerprint, ct->hash);
+		if((tchdr = cache_map(ctx->cache, key, "tc", &mapsize))) {
+			/* the levels are packed one after the other, so with the right
+			 * size for each one they're all where they should be
+			 */
+			badsize = 0;
+			for(i=0, pos=sizeof *tchdr; i<ct->levels && mapsize >= sizeof *tchdr; i++) {
+				unsigned int expect = ct->size[i] ? transcode_level_size(dstfmt,
+						comptex_level_width(ct, i), comptex_level_height(ct, i)) : 0;
+				if(tchdr->size[i] != expect) {
+					badsize = 1;
+				}
+				pos += tchdr->size[i];
+			}
+			if(mapsize < sizeof *tchdr || memcmp(tchdr->magic, "COMPTC00", 8) != 0 ||
+					tchdr->glfmt != dstfmt || tchdr->levels != ct->levels || badsize ||
+					pos > mapsize) {
+				cache_unmap(tchdr, mapsize);
+			} else {
+				printf("%s: using cached transcoded data\n", fname);
+
+				dst = (unsigned char*)(tchdr + 1);
+				for(i=0; i<ct->levels; i++) {
+					ct->size[i] = tchdr->size[i];
+					ct->data[i] = ct->size[i] ? dst : 0;
+					dst += ct->size[i];
+				}
+				ct->fmt = dstfmt;
+				ct->layout = LAYOUT_LINEAR;
+				ct->mem = tchdr;
+				ct->memsize = mapsize;
+				ct->mapped = 1;
+				return 0;
+			}
+		}
+	}
+
+	tcsize = sizeof *tchdr;
+	for(i=0; i<ct->levels; i++) {
+		if(ct->size[i]) {
+			tcsize += transcode_level_size(dstfmt, comptex_level_width(ct, i),
+					comptex_level_height(ct, i));
+		}
+	}
+	if(!(tchdr = calloc(1, tcsize))) {
+		fprintf(stderr, "failed to allocate transcoding buffer (%d bytes)\n", (int)tcsize);
+		return -1;
+	}
+	memcpy(tchdr->magic, "COMPTC00", 8);
+	tchdr->glfmt = dstfmt;
+	tchdr->levels = ct->levels;
+
+	/* the decoder works on linear levels, level 0 is the largest */
+	if(ct->layout != LAYOUT_LINEAR && !(lin = malloc(ct->size[0]))) {
+		fprintf(stderr, "failed to allocate unswizzling buffer (%u bytes)\n", ct->size[0]);
+		free(tchdr);
+		return -1;
+	}
+
+	dst = (unsigned char*)(tchdr + 1);
+	for(i=0; i<ct->levels; i++) {
+		int width = comptex_level_width(ct, i);
+		int height = comptex_level_height(ct, i);
+
+		if(!ct->size[i]) {
+			continue;
+		}
+		tchdr->size[i] = transcode_level_size(dstfmt, width, height);
+
+		t0 = get_msec();
+		if(lin) {
+			comptex_linear_level(ct, i, lin);
+		}
+		if(transcode(ct->srcfmt, lin ? lin : ct->data[i], dstfmt, dst, width, height, 0) == -1) {
+			fprintf(stderr, "%s: failed to transcode level %d to %s\n", fname, i, fmtstr(dstfmt));
+			free(lin);
+			free(tchdr);
+			return -1;
+		}
+		tc_msec += get_msec() - t0;
+		tc_mpix += width * height / 1000000.0;
+
+		ct->size[i] = tchdr->size[i];
+		ct->data[i] = dst;
+		dst += ct->size[i];
+	}
+
+	printf("transcoded %s -> %s: %.3f Mpixels in %.3f ms (%.3f ms/Mpixel)\n",
+			fmtstr(ct->srcfmt), fmtstr(dstfmt), tc_mpix, tc_msec,
+			tc_mpix > 0.0 ? tc_msec / tc_mpix : 0.0);
+
+	free(lin);
+
+	if(ct->hash) {
+		cache_store(ctx->cache, key, "tc", tchdr, tcsize);
+	}
+
+	ct->fmt = dstfmt;
+	ct->layout = LAYOUT_LINEAR;
+	ct->mem = tchdr;
+	ct->memsize = tcsize;
+	ct->mapped = 0;
+	return 0;
+}
+
+void free_comptex(struct comptex *ct)
+{
+	if(ct->mapped) {
+		cache_unmap(ct->mem, ct->memsize);
+	} else {
+		free(ct->mem);
+	}
+	ct->mem = 0;
+	ct->memsize = 0;
+	ct->mapped = 0;
+	memset(ct->data, 0, sizeof ct->data);
+}
+
+int comptex_level_width(const struct comptex *ct, int level)
+{
+	int w = ct->width >> level;
+	return w > 0 ? w : 1;
+}
+
+int comptex_level_height(const struct comptex *ct, int level)
+{
+	int h = ct->height >> level;
+	return h > 0 ? h : 1;
+}
+
+int check_level_size(const char *fname, unsigned int fmt, int width, int height, int level,
+		unsigned int size)
+{
+	unsigned int expect;
+
+	if(!size) return 0;
+
+	/* the transcoder and the block reordering read as much as the level
+	 * dimensions call for, whatever the file says
+	 */
+	if((expect = transcode_level_size(fmt, width >> level, height >> level)) && size != expect) {
+		fprintf(stderr, "%s: level %d is %u bytes, expected %u for %dx%d %s\n", fname, level,
+				size, expect, width >> level > 0 ? width >> level : 1,
+				height >> level > 0 ? height >> level : 1, fmtstr(fmt));
+		return -1;
+	}
+	return 0;
+}
+
+void comptex_linear_level(const struct comptex *ct, int level, void *dst)
+{
+	if(ct->layout == LAYOUT_LINEAR) {
+		memcpy(dst, ct->data[level], ct->size[level]);
+	} else {
+		unswizzle_level(ct->layout, ct->data[level], dst, comptex_level_width(ct, level),
+				comptex_level_height(ct, level), transcode_block_size(ct->fmt));
+	}
+}
+
+/* enums as plain numbers, like in transcode.h, to keep GL headers out of here */
+const char *fmtstr(int fmt)
+{
+	switch(fmt) {
+	case 0x86b0: return "GL_COMPRESSED_RGB_FXT1_3DFX";
+	case 0x86b1: return "GL_COMPRESSED_RGBA_FXT1_3DFX";
+	case 0x8dbb: return "GL_COMPRESSED_RED_RGTC1";
+	case 0x8dbc: return "GL_COMPRESSED_SIGNED_RED_RGTC1";
+	case 0x8dbd: return "GL_COMPRESSED_RG_RGTC2";
+	case 0x8dbe: return "GL_COMPRESSED_SIGNED_RG_RGTC2";
+	case 0x8e8c: return "GL_COMPRESSED_RGBA_BPTC_UNORM";
+	case 0x8e8d: return "GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM";
+	case 0x8e8e: return "GL_COMPRESSED_RGB_BPTC_SIGNED_FLOAT";
+	case 0x8e8f: return "GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT";
+	case 0x9274: return "GL_COMPRESSED_RGB8_ETC2";
+	case 0x9275: return "GL_COMPRESSED_SRGB8_ETC2";
+	case 0x9276: return "GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2";
+	case 0x9277: return "GL_COMPRESSED_SRGB8_PUNCHTHROUGH_ALPHA1_ETC2";
+	case 0x9278: return "GL_COMPRESSED_RGBA8_ETC2_EAC";
+	case 0x9279: return "GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC";
+	case 0x9270: return "GL_COMPRESSED_R11_EAC";
+	case 0x9271: return "GL_COMPRESSED_SIGNED_R11_EAC";
+	case 0x9272: return "GL_COMPRESSED_RG11_EAC";
+	case 0x9273: return "GL_COMPRESSED_SIGNED_RG11_EAC";
+	case 0x83F0: return "GL_COMPRESSED_RGB_S3TC_DXT1_EXT";
+	case 0x83F1: return "GL_COMPRESSED_RGBA_S3TC_DXT1_EXT";
+	case 0x83F2: return "GL_COMPRESSED_RGBA_S3TC_DXT3_EXT";
+	case 0x83F3: return "GL_COMPRESSED_RGBA_S3TC_DXT5_EXT";
+	case 0x8C48: return "GL_COMPRESSED_SRGB_EXT";
+	case 0x8C49: return "GL_COMPRESSED_SRGB_ALPHA_EXT";
+	case 0x8C4A: return "GL_COMPRESSED_SLUMINANCE_EXT";
+	case 0x8C4B: return "GL_COMPRESSED_SLUMINANCE_ALPHA_EXT";
+	case 0x8C4C: return "GL_COMPRESSED_SRGB_S3TC_DXT1_EXT";
+	case 0x8C4D: return "GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT";
+	case 0x8C4E: return "GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT";
+	case 0x8C4F: return "GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT";
+	case 0x8B90: return "GL_PALETTE4_RGB8_OES";
+	case 0x8B91: return "GL_PALETTE4_RGBA8_OES";
+	case 0x8B92: return "GL_PALETTE4_R5_G6_B5_OES";
+	case 0x8B93: return "GL_PALETTE4_RGBA4_OES";
+	case 0x8B94: return "GL_PALETTE4_RGB5_A1_OES";
+	case 0x8B95: return "GL_PALETTE8_RGB8_OES";
+	case 0x8B96: return "GL_PALETTE8_RGBA8_OES";
+	case 0x8B97: return "GL_PALETTE8_R5_G6_B5_OES";
+	case 0x8B98: return "GL_PALETTE8_RGBA4_OES";
+	case 0x8B99: return "GL_PALETTE8_RGB5_A1_OES";
+	case 0x93B0: return "GL_COMPRESSED_RGBA_ASTC_4";
+	case 0x93B1: return "GL_COMPRESSED_RGBA_ASTC_5";
+	case 0x93B2: return "GL_COMPRESSED_RGBA_ASTC_5";
+	case 0x93B3: return "GL_COMPRESSED_RGBA_ASTC_6";
+	case 0x93B4: return "GL_COMPRESSED_RGBA_ASTC_6";
+	case 0x93B5: return "GL_COMPRESSED_RGBA_ASTC_8";
+	case 0x93B6: return "GL_COMPRESSED_RGBA_ASTC_8";
+	case 0x93B7: return "GL_COMPRESSED_RGBA_ASTC_8";
+	case 0x93B8: return "GL_COMPRESSED_RGBA_ASTC_10";
+	case 0x93B9: return "GL_COMPRESSED_RGBA_ASTC_10";
+	case 0x93BA: return "GL_COMPRESSED_RGBA_ASTC_10";
+	case 0x93BB: return "GL_COMPRESSED_RGBA_ASTC_10";
+	case 0x93BC: return "GL_COMPRESSED_RGBA_ASTC_12";
+	case 0x93BD: return "GL_COMPRESSED_RGBA_ASTC_12";
+	case 0x93D0: return "GL_COMPRESSED_SRGB8_ALPHA8_ASTC_4";
+	case 0x93D1: return "GL_COMPRESSED_SRGB8_ALPHA8_ASTC_5";
+	case 0x93D2: return "GL_COMPRESSED_SRGB8_ALPHA8_ASTC_5";
+	case 0x93D3: return "GL_COMPRESSED_SRGB8_ALPHA8_ASTC_6";
+	case 0x93D4: return "GL_COMPRESSED_SRGB8_ALPHA8_ASTC_6";
+	case 0x93D5: return "GL_COMPRESSED_SRGB8_ALPHA8_ASTC_8";
+	case 0x93D6: return "GL_COMPRESSED_SRGB8_ALPHA8_ASTC_8";
+	case 0x93D7: return "GL_COMPRESSED_SRGB8_ALPHA8_ASTC_8";
+	case 0x93D8: return "GL_COMPRESSED_SRGB8_ALPHA8_ASTC_10";
+	case 0x93D9: return "GL_COMPRESSED_SRGB8_ALPHA8_ASTC_10";
+	case 0x93DA: return "GL_COMPRESSED_SRGB8_ALPHA8_ASTC_10";
+	case 0x93DB: return "GL_COMPRESSED_SRGB8_ALPHA8_ASTC_10";
+	case 0x93DC: return "GL_COMPRESSED_SRGB8_ALPHA8_ASTC_12";
+	case 0x93DD: return "GL_COMPRESSED_SRGB8_ALPHA8_ASTC_12";
+	case 0x1909:
+	case 1:
+		return "GL_LUMINANCE";
+	case 0x1907:
+	case 3:
+		return "GL_RGB";
+	case 0x1908:
+	case 4:
+		return "GL_RGBA";
+	case 0x8058: return "GL_RGBA8";
+	case 0x80e0: return "GL_BGR";
+	case 0x80e1: return "GL_BGRA";
+	case 0x8c46: return "GL_SLUMINANCE";
+	case 0x8c47: return "GL_SLUMINANCE8";
+	case 0x8c44: return "GL_SLUMINANCE_ALPHA";
+	case 0x8c45: return "GL_SLUMINANCE8_ALPHA8";
+	case 0x8c40: return "GL_SRGB";
+	case 0x8c41: return "GL_SRGB8";
+	case 0x8c42: return "GL_SRGB_ALPHA";
+	case 0x8c43: return "GL_SRGB8_ALPHA8";
+	default:
+		break;
+	}
+	return "unknown";
+}
+
+int fmt_supported(const struct comptex_ctx *ctx, unsigned int fmt)
+{
+	int i;
+
+	for(i=0; i<ctx->num_fmt; i++) {
+		if(ctx->fmt[i] == fmt) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+double get_msec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
@@ -0,0 +1,104 @@
+#ifndef TEXTURE_H_
+#define TEXTURE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define MAX_LEVELS	20
+
+/* on-disk header of COMPTEX0 files, the level data follows it. datadesc
+ * offsets are relative to the end of the header.
+ */
+struct comptex_header {
+	char magic[8];
+	uint32_t glfmt;
+	uint16_t flags;
+	uint16_t levels;
+	uint32_t width, height;
+	struct {
+		uint32_t offset, size;
+	} datadesc[MAX_LEVELS];
+	char unused[8];
+};
+
+/* bits 1-2 of the header flags: block order of the levels, LAYOUT_* in swizzle.h */
+#define COMPTEX_LAYOUT(flags)			(((flags) >> 1) & 3)
+#define COMPTEX_LAYOUT_FLAGS(layout)	((layout) << 1)
+
+/* contents of a compressed texture file in host memory, in the format it's
+ * going to be uploaded as (i.e. after transcoding, if that was necessary)
+ */
+struct comptex {
+	unsigned int fmt;
+	unsigned int srcfmt;
+	int width, height;
+	int levels;
+	unsigned int size[MAX_LEVELS];
+	unsigned char *data[MAX_LEVELS];	/* 0 for empty levels */
+	int layout;		/* block order of the level data, converted to linear on upload */
+	uint64_t hash;
+
+	/* backing memory of the level data, either allocated or a mapped cache entry */
+	void *mem;
+	size_t memsize;
+	int mapped;
+};
+
+struct cache;
+
+/* loader context, created and set up through comptex.h */
+struct comptex_ctx {
+	/* compressed formats advertised by the driver. Left empty, read_comptex
+	 * transcodes everything it can decode.
+	 */
+	int *fmt;
+	int num_fmt;
+
+	/* hash of the compressed format list, and of that plus the driver strings */
+	uint64_t fmt_fingerprint, drv_fingerprint;
+	uint64_t drv_hash;		/* hash of just the driver strings */
+
+	struct cache *cache;	/* 0 if disabled */
+};
+
+/* read a texture file into host memory, transcoding it if necessary. Free
+ * with free_comptex, which keeps everything but the level data around.
+ */
+int read_comptex(struct comptex_ctx *ctx, const char *fname, struct comptex *ct);
+void free_comptex(struct comptex *ct);
+
+/* called for every texture of a batch as soon as all its levels are in. The
+ * level data may point into the batch arena, which is only valid until the
+ * callback returns. The callback must free_comptex it when done.
+ */
+typedef void (*comptex_func)(int idx, struct comptex *ct, void *cls);
+
+struct batch_stats {
+	int backend;			/* AIO_URING or AIO_THREADS */
+	int files, failed;
+	unsigned long reads;
+	size_t bytes;
+	double msec;			/* wall clock time of the whole batch */
+	double cb_msec;			/* time spent in the callback */
+};
+
+/* read many texture files with asynchronous reads, backend is one of the
+ * AIO_* constants in aio.h. Returns -1 if any of them failed to load.
+ */
+int read_comptex_batch(struct comptex_ctx *ctx, const char **fnames, int num, int backend,
+		comptex_func done, void *cls, struct batch_stats *bst);
+int comptex_level_width(const struct comptex *ct, int level);
+int comptex_level_height(const struct comptex *ct, int level);
+/* fails if a non-empty level isn't the size its dimensions call for in fmt.
+ * Formats of unknown size always pass, they can only be uploaded as they are.
+ */
+int check_level_size(const char *fname, unsigned int fmt, int width, int height, int level,
+		unsigned int size);
+/* copy a level to dst in linear block order */
+void comptex_linear_level(const struct comptex *ct, int level, void *dst);
+
+const char *fmtstr(int fmt);
+int fmt_supported(const struct comptex_ctx *ctx, unsigned int fmt);
+double get_msec(void);
+
+#endif	/* TEXTURE_H_ */
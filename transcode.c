@@ -0,0 +1,1145 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "transcode.h"
+
+#define CLAMP(x, a, b)	((x) < (a) ? (a) : ((x) > (b) ? (b) : (x)))
+
+struct job {
+	unsigned int srcfmt, dstfmt;
+	const unsigned char *src;
+	unsigned char *dst;
+	int width, height;
+	int first_row, last_row;	/* range of block rows [first, last) */
+};
+
+static void *worker(void *cls);
+static void transcode_rows(struct job *job);
+static void decode_block(unsigned int fmt, const unsigned char *src, unsigned char *pix);
+static void encode_block(unsigned int fmt, const unsigned char *pix, unsigned char *dst);
+
+
+int transcode_block_size(unsigned int fmt)
+{
+	switch(fmt) {
+	case TC_RGB_S3TC_DXT1:
+	case TC_RGBA_S3TC_DXT1:
+	case TC_SRGB_S3TC_DXT1:
+	case TC_SRGB_ALPHA_S3TC_DXT1:
+	case TC_RED_RGTC1:
+	case 0x8dbc:	/* signed RGTC1 */
+	case TC_R11_EAC:
+	case 0x9271:	/* signed R11 EAC */
+	case TC_RGB8_ETC2:
+	case TC_SRGB8_ETC2:
+	case TC_RGB8_PUNCHTHROUGH_ETC2:
+	case TC_SRGB8_PUNCHTHROUGH_ETC2:
+		return 8;
+
+	case TC_RGBA_S3TC_DXT3:
+	case TC_RGBA_S3TC_DXT5:
+	case TC_SRGB_ALPHA_S3TC_DXT3:
+	case TC_SRGB_ALPHA_S3TC_DXT5:
+	case TC_RG_RGTC2:
+	case 0x8dbe:	/* signed RGTC2 */
+	case TC_RG11_EAC:
+	case 0x9273:	/* signed RG11 EAC */
+	case TC_RGBA8_ETC2_EAC:
+	case TC_SRGB8_ALPHA8_ETC2_EAC:
+	case TC_RGBA_BPTC_UNORM:
+	case TC_SRGB_ALPHA_BPTC_UNORM:
+	case 0x8e8e:	/* BPTC float */
+	case 0x8e8f:
+	case 0x93b0:	/* ASTC 4x4 */
+	case 0x93d0:
+		return 16;
+
+	default:
+		break;
+	}
+	return 0;
+}
+
+int transcode_is_compressed(unsigned int fmt)
+{
+	return transcode_block_size(fmt) > 0;
+}
+
+int transcode_is_uncompressed(unsigned int fmt)
+{
+	return fmt == TC_RGBA8 || fmt == TC_SRGB8_ALPHA8;
+}
+
+unsigned int transcode_level_size(unsigned int fmt, int width, int height)
+{
+	int bsz;
+
+	if(width < 1) width = 1;
+	if(height < 1) height = 1;
+
+	if(transcode_is_uncompressed(fmt)) {
+		return width * height * 4;
+	}
+	if(!(bsz = transcode_block_size(fmt))) {
+		return 0;
+	}
+	return ((width + 3) / 4) * ((height + 3) / 4) * bsz;
+}
+
+int transcode_can_decode(unsigned int fmt)
+{
+	switch(fmt) {
+	case TC_RGB_S3TC_DXT1:
+	case TC_RGBA_S3TC_DXT1:
+	case TC_RGBA_S3TC_DXT3:
+	case TC_RGBA_S3TC_DXT5:
+	case TC_SRGB_S3TC_DXT1:
+	case TC_SRGB_ALPHA_S3TC_DXT1:
+	case TC_SRGB_ALPHA_S3TC_DXT3:
+	case TC_SRGB_ALPHA_S3TC_DXT5:
+	case TC_RED_RGTC1:
+	case TC_RG_RGTC2:
+	case TC_R11_EAC:
+	case TC_RG11_EAC:
+	case TC_RGB8_ETC2:
+	case TC_SRGB8_ETC2:
+	case TC_RGB8_PUNCHTHROUGH_ETC2:
+	case TC_SRGB8_PUNCHTHROUGH_ETC2:
+	case TC_RGBA8_ETC2_EAC:
+	case TC_SRGB8_ALPHA8_ETC2_EAC:
+	case TC_RGBA_BPTC_UNORM:
+	case TC_SRGB_ALPHA_BPTC_UNORM:
+		return 1;
+	default:
+		break;
+	}
+	return 0;
+}
+
+static int in_list(unsigned int fmt, const int *fmtlist, int num_fmt)
+{
+	int i;
+	for(i=0; i<num_fmt; i++) {
+		if(fmtlist[i] == fmt) return 1;
+	}
+	return 0;
+}
+
+unsigned int transcode_target(unsigned int srcfmt, const int *fmtlist, int num_fmt)
+{
+	int i;
+	const unsigned int *cand;
+
+	/* candidate targets for each class of source format, in order of
+	 * preference. The uncompressed format at the end of each list is always
+	 * available.
+	 */
+	static const unsigned int opaque_cand[] = {TC_RGB_S3TC_DXT1, TC_RGBA8};
+	static const unsigned int punch_cand[] = {TC_RGBA_S3TC_DXT1, TC_RGBA_S3TC_DXT5, TC_RGBA8};
+	static const unsigned int alpha_cand[] = {TC_RGBA_S3TC_DXT5, TC_RGBA8};
+	static const unsigned int srgb_opaque_cand[] = {TC_SRGB_S3TC_DXT1, TC_SRGB8_ALPHA8};
+	static const unsigned int srgb_punch_cand[] = {TC_SRGB_ALPHA_S3TC_DXT1,
+		TC_SRGB_ALPHA_S3TC_DXT5, TC_SRGB8_ALPHA8};
+	static const unsigned int srgb_alpha_cand[] = {TC_SRGB_ALPHA_S3TC_DXT5, TC_SRGB8_ALPHA8};
+	static const unsigned int red_cand[] = {TC_RED_RGTC1, TC_RGBA8};
+	static const unsigned int rg_cand[] = {TC_RG_RGTC2, TC_RGBA8};
+	static const unsigned int rgba8_cand[] = {TC_RGBA8};
+
+	switch(srcfmt) {
+	case TC_RGB_S3TC_DXT1:
+	case TC_RGB8_ETC2:
+		cand = opaque_cand;
+		break;
+	case TC_RGBA_S3TC_DXT1:
+	case TC_RGB8_PUNCHTHROUGH_ETC2:
+		cand = punch_cand;
+		break;
+	case TC_RGBA_S3TC_DXT3:
+	case TC_RGBA_S3TC_DXT5:
+	case TC_RGBA8_ETC2_EAC:
+	case TC_RGBA_BPTC_UNORM:
+		cand = alpha_cand;
+		break;
+	case TC_SRGB_S3TC_DXT1:
+	case TC_SRGB8_ETC2:
+		cand = srgb_opaque_cand;
+		break;
+	case TC_SRGB_ALPHA_S3TC_DXT1:
+	case TC_SRGB8_PUNCHTHROUGH_ETC2:
+		cand = srgb_punch_cand;
+		break;
+	case TC_SRGB_ALPHA_S3TC_DXT3:
+	case TC_SRGB_ALPHA_S3TC_DXT5:
+	case TC_SRGB8_ALPHA8_ETC2_EAC:
+	case TC_SRGB_ALPHA_BPTC_UNORM:
+		cand = srgb_alpha_cand;
+		break;
+	case TC_R11_EAC:
+		cand = red_cand;
+		break;
+	case TC_RG11_EAC:
+		cand = rg_cand;
+		break;
+	case TC_RED_RGTC1:
+	case TC_RG_RGTC2:
+		cand = rgba8_cand;
+		break;
+	default:
+		return 0;
+	}
+
+	for(i=0; ; i++) {
+		if(!transcode_is_compressed(cand[i]) || in_list(cand[i], fmtlist, num_fmt)) {
+			return cand[i];
+		}
+	}
+	return 0;
+}
+
+static int can_encode(unsigned int fmt)
+{
+	switch(fmt) {
+	case TC_RGB_S3TC_DXT1:
+	case TC_RGBA_S3TC_DXT1:
+	case TC_RGBA_S3TC_DXT5:
+	case TC_SRGB_S3TC_DXT1:
+	case TC_SRGB_ALPHA_S3TC_DXT1:
+	case TC_SRGB_ALPHA_S3TC_DXT5:
+	case TC_RED_RGTC1:
+	case TC_RG_RGTC2:
+	case TC_RGBA8:
+	case TC_SRGB8_ALPHA8:
+		return 1;
+	default:
+		break;
+	}
+	return 0;
+}
+
+int transcode(unsigned int srcfmt, const void *src, unsigned int dstfmt, void *dst,
+		int width, int height, int nthreads)
+{
+	int i, rows, per_thread, nspawned;
+	struct job *jobs;
+	pthread_t *threads;
+
+	if(!transcode_can_decode(srcfmt) || !can_encode(dstfmt)) {
+		return -1;
+	}
+	if(width < 1) width = 1;
+	if(height < 1) height = 1;
+
+	rows = (height + 3) / 4;
+	if(nthreads <= 0) {
+		nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+	}
+	if(nthreads > rows) nthreads = rows;
+	if(nthreads < 1) nthreads = 1;
+
+	if(!(jobs = malloc(nthreads * (sizeof *jobs + sizeof *threads)))) {
+		return -1;
+	}
+	threads = (pthread_t*)(jobs + nthreads);
+
+	per_thread = (rows + nthreads - 1) / nthreads;
+	for(i=0; i<nthreads; i++) {
+		jobs[i].srcfmt = srcfmt;
+		jobs[i].dstfmt = dstfmt;
+		jobs[i].src = src;
+		jobs[i].dst = dst;
+		jobs[i].width = width;
+		jobs[i].height = height;
+		jobs[i].first_row = i * per_thread;
+		jobs[i].last_row = CLAMP((i + 1) * per_thread, 0, rows);
+	}
+
+	/* the calling thread takes the first share of the work itself, and
+	 * anything we failed to spawn a thread for
+	 */
+	for(i=1; i<nthreads; i++) {
+		if(pthread_create(threads + i, 0, worker, jobs + i) != 0) {
+			break;
+		}
+	}
+	nspawned = i;
+
+	transcode_rows(jobs);
+	for(i=nspawned; i<nthreads; i++) {
+		transcode_rows(jobs + i);
+	}
+
+	for(i=1; i<nspawned; i++) {
+		pthread_join(threads[i], 0);
+	}
+	free(jobs);
+	return 0;
+}
+
+static void *worker(void *cls)
+{
+	transcode_rows(cls);
+	return 0;
+}
+
+static void transcode_rows(struct job *job)
+{
+	int i, j, x, y, xsz, ysz;
+	int bcols = (job->width + 3) / 4;
+	int sbsz = transcode_block_size(job->srcfmt);
+	int dbsz = transcode_block_size(job->dstfmt);
+	const unsigned char *src;
+	unsigned char pix[16 * 4];
+
+	src = job->src + job->first_row * bcols * sbsz;
+
+	for(i=job->first_row; i<job->last_row; i++) {
+		for(j=0; j<bcols; j++) {
+			decode_block(job->srcfmt, src, pix);
+			src += sbsz;
+
+			if(dbsz) {
+				encode_block(job->dstfmt, pix, job->dst + (i * bcols + j) * dbsz);
+				continue;
+			}
+
+			/* uncompressed destination, copy the part of the block inside the image */
+			xsz = CLAMP(job->width - j * 4, 0, 4);
+			ysz = CLAMP(job->height - i * 4, 0, 4);
+			for(y=0; y<ysz; y++) {
+				unsigned char *dptr = job->dst + ((i * 4 + y) * job->width + j * 4) * 4;
+				for(x=0; x<xsz; x++) {
+					memcpy(dptr + x * 4, pix + (y * 4 + x) * 4, 4);
+				}
+			}
+		}
+	}
+}
+
+/* ---- decoders: each one writes a 4x4 block of RGBA8 pixels in pix ---- */
+
+static uint64_t load64be(const unsigned char *p)
+{
+	int i;
+	uint64_t v = 0;
+	for(i=0; i<8; i++) {
+		v = (v << 8) | p[i];
+	}
+	return v;
+}
+
+static uint64_t load48le(const unsigned char *p)
+{
+	int i;
+	uint64_t v = 0;
+	for(i=5; i>=0; i--) {
+		v = (v << 8) | p[i];
+	}
+	return v;
+}
+
+static void unpack565(unsigned int c, unsigned char *rgba)
+{
+	unsigned int r = (c >> 11) & 0x1f;
+	unsigned int g = (c >> 5) & 0x3f;
+	unsigned int b = c & 0x1f;
+
+	rgba[0] = (r << 3) | (r >> 2);
+	rgba[1] = (g << 2) | (g >> 4);
+	rgba[2] = (b << 3) | (b >> 2);
+	rgba[3] = 255;
+}
+
+/* colour block modes: DXT1 picks 4 colours or 3 + black (transparent with
+ * punch-through alpha) from the endpoint order, DXT3/5 always use 4 colours
+ */
+enum { DXT_OPAQUE, DXT_PUNCH, DXT_FOUR };
+
+static void dxt_palette(unsigned int c0, unsigned int c1, int mode, unsigned char pal[4][4])
+{
+	int i;
+	int four = c0 > c1 || mode == DXT_FOUR;
+
+	unpack565(c0, pal[0]);
+	unpack565(c1, pal[1]);
+
+	for(i=0; i<3; i++) {
+		if(four) {
+			pal[2][i] = (2 * pal[0][i] + pal[1][i]) / 3;
+			pal[3][i] = (pal[0][i] + 2 * pal[1][i]) / 3;
+		} else {
+			pal[2][i] = (pal[0][i] + pal[1][i]) / 2;
+			pal[3][i] = 0;
+		}
+	}
+	pal[2][3] = 255;
+	pal[3][3] = (!four && mode == DXT_PUNCH) ? 0 : 255;
+}
+
+static void decode_dxt_color(const unsigned char *src, unsigned char *pix, int mode)
+{
+	int i;
+	unsigned char pal[4][4];
+	unsigned int bits = src[4] | (src[5] << 8) | (src[6] << 16) | ((unsigned int)src[7] << 24);
+
+	dxt_palette(src[0] | (src[1] << 8), src[2] | (src[3] << 8), mode, pal);
+
+	for(i=0; i<16; i++) {
+		memcpy(pix + i * 4, pal[(bits >> (i * 2)) & 3], 4);
+	}
+}
+
+static void bc4_palette(unsigned int a0, unsigned int a1, unsigned int *pal)
+{
+	int i;
+
+	pal[0] = a0;
+	pal[1] = a1;
+	if(a0 > a1) {
+		for(i=1; i<7; i++) {
+			pal[i + 1] = ((7 - i) * a0 + i * a1 + 3) / 7;
+		}
+	} else {
+		for(i=1; i<5; i++) {
+			pal[i + 1] = ((5 - i) * a0 + i * a1 + 2) / 5;
+		}
+		pal[6] = 0;
+		pal[7] = 255;
+	}
+}
+
+/* BC4 style 8 byte block (RGTC channels, DXT5 alpha) into channel chan */
+static void decode_bc4(const unsigned char *src, unsigned char *pix, int chan)
+{
+	int i;
+	unsigned int pal[8];
+	uint64_t bits = load48le(src + 2);
+
+	bc4_palette(src[0], src[1], pal);
+
+	for(i=0; i<16; i++) {
+		pix[i * 4 + chan] = pal[(bits >> (i * 3)) & 7];
+	}
+}
+
+static const int etc_mod[8][2] = {
+	{2, 8}, {5, 17}, {9, 29}, {13, 42}, {18, 60}, {24, 80}, {33, 106}, {47, 183}
+};
+static const int etc_dist[8] = {3, 6, 11, 16, 20, 23, 27, 32};
+
+static const int eac_mod[16][8] = {
+	{-3, -6, -9, -15, 2, 5, 8, 14},
+	{-3, -7, -10, -13, 2, 6, 9, 12},
+	{-2, -5, -8, -13, 1, 4, 7, 12},
+	{-2, -4, -6, -13, 1, 3, 5, 12},
+	{-3, -6, -8, -12, 2, 5, 7, 11},
+	{-3, -7, -9, -11, 2, 6, 8, 10},
+	{-4, -7, -8, -11, 3, 6, 7, 10},
+	{-3, -5, -8, -11, 2, 4, 7, 10},
+	{-2, -6, -8, -10, 1, 5, 7, 9},
+	{-2, -5, -8, -10, 1, 4, 7, 9},
+	{-2, -4, -8, -10, 1, 3, 7, 9},
+	{-2, -5, -7, -10, 1, 4, 6, 9},
+	{-3, -4, -7, -10, 2, 3, 6, 9},
+	{-1, -2, -3, -10, 0, 1, 2, 9},
+	{-4, -6, -8, -9, 3, 5, 7, 8},
+	{-3, -5, -7, -9, 2, 4, 6, 8}
+};
+
+#define EXT4(x)	((((x) & 0xf) << 4) | ((x) & 0xf))
+#define EXT5(x)	((((x) & 0x1f) << 3) | (((x) & 0x1f) >> 2))
+#define EXT6(x)	((((x) & 0x3f) << 2) | (((x) & 0x3f) >> 4))
+#define EXT7(x)	((((x) & 0x7f) << 1) | (((x) & 0x7f) >> 6))
+#define SEXT3(x)	((int)((x) & 7) - (((x) & 4) << 1))
+
+/* ETC pixels are stored in column-major order: pixel (x, y) is bit x * 4 + y
+ * of each of the two 16 bit index planes.
+ */
+#define ETC_IDX(b, x, y) \
+	((((b) >> (16 + (x) * 4 + (y))) & 1) << 1 | (((b) >> ((x) * 4 + (y))) & 1))
+
+static void etc_paint(unsigned char *pix, uint64_t b, int paint[4][3], int opaque)
+{
+	int x, y, i;
+
+	for(y=0; y<4; y++) {
+		for(x=0; x<4; x++) {
+			int idx = ETC_IDX(b, x, y);
+			unsigned char *p = pix + (y * 4 + x) * 4;
+
+			if(!opaque && idx == 2) {
+				p[0] = p[1] = p[2] = p[3] = 0;
+				continue;
+			}
+			for(i=0; i<3; i++) {
+				p[i] = CLAMP(paint[idx][i], 0, 255);
+			}
+			p[3] = 255;
+		}
+	}
+}
+
+static void etc_subblocks(unsigned char *pix, uint64_t b, int base[2][3], int opaque)
+{
+	int x, y, i;
+	int cw[2], flip;
+
+	cw[0] = (b >> 37) & 7;
+	cw[1] = (b >> 34) & 7;
+	flip = (b >> 32) & 1;
+
+	for(y=0; y<4; y++) {
+		for(x=0; x<4; x++) {
+			int sub = flip ? y >= 2 : x >= 2;
+			int idx = ETC_IDX(b, x, y);
+			int mod = etc_mod[cw[sub]][idx & 1];
+			unsigned char *p = pix + (y * 4 + x) * 4;
+
+			if(!opaque) {
+				if(idx == 2) {
+					p[0] = p[1] = p[2] = p[3] = 0;
+					continue;
+				}
+				if(!(idx & 1)) mod = 0;
+			}
+			if(idx & 2) mod = -mod;
+
+			for(i=0; i<3; i++) {
+				p[i] = CLAMP(base[sub][i] + mod, 0, 255);
+			}
+			p[3] = 255;
+		}
+	}
+}
+
+static void decode_etc2(const unsigned char *src, unsigned char *pix, int punch)
+{
+	int i, x, y, r, g, b, dr, dg, db, dist;
+	int opaque = 1;
+	int base[2][3], paint[4][3];
+	uint64_t bits = load64be(src);
+	int diff = (bits >> 33) & 1;
+
+	if(punch) {
+		/* punch-through alpha uses the diff bit as an opaque flag, and
+		 * always uses the differential layout
+		 */
+		opaque = diff;
+		diff = 1;
+	}
+
+	if(!diff) {
+		base[0][0] = EXT4(bits >> 60);
+		base[0][1] = EXT4(bits >> 52);
+		base[0][2] = EXT4(bits >> 44);
+		base[1][0] = EXT4(bits >> 56);
+		base[1][1] = EXT4(bits >> 48);
+		base[1][2] = EXT4(bits >> 40);
+		etc_subblocks(pix, bits, base, 1);
+		return;
+	}
+
+	r = (bits >> 59) & 0x1f;
+	g = (bits >> 51) & 0x1f;
+	b = (bits >> 43) & 0x1f;
+	dr = SEXT3(bits >> 56);
+	dg = SEXT3(bits >> 48);
+	db = SEXT3(bits >> 40);
+
+	if(r + dr < 0 || r + dr > 31) {
+		/* T mode */
+		paint[0][0] = EXT4(((bits >> 57) & 0xc) | ((bits >> 56) & 3));
+		paint[0][1] = EXT4(bits >> 52);
+		paint[0][2] = EXT4(bits >> 48);
+		paint[2][0] = EXT4(bits >> 44);
+		paint[2][1] = EXT4(bits >> 40);
+		paint[2][2] = EXT4(bits >> 36);
+		dist = etc_dist[((bits >> 33) & 6) | ((bits >> 32) & 1)];
+
+		for(i=0; i<3; i++) {
+			paint[1][i] = paint[2][i] + dist;
+			paint[3][i] = paint[2][i] - dist;
+		}
+		etc_paint(pix, bits, paint, opaque);
+
+	} else if(g + dg < 0 || g + dg > 31) {
+		/* H mode */
+		int c0[3], c1[3];
+
+		c0[0] = (bits >> 59) & 0xf;
+		c0[1] = ((bits >> 55) & 0xe) | ((bits >> 52) & 1);
+		c0[2] = ((bits >> 48) & 8) | ((bits >> 47) & 7);
+		c1[0] = (bits >> 43) & 0xf;
+		c1[1] = (bits >> 39) & 0xf;
+		c1[2] = (bits >> 35) & 0xf;
+
+		dist = ((bits >> 32) & 4) | ((bits >> 31) & 2);
+		if(((c0[0] << 8) | (c0[1] << 4) | c0[2]) >= ((c1[0] << 8) | (c1[1] << 4) | c1[2])) {
+			dist |= 1;
+		}
+		dist = etc_dist[dist];
+
+		for(i=0; i<3; i++) {
+			paint[0][i] = EXT4(c0[i]) + dist;
+			paint[1][i] = EXT4(c0[i]) - dist;
+			paint[2][i] = EXT4(c1[i]) + dist;
+			paint[3][i] = EXT4(c1[i]) - dist;
+		}
+		etc_paint(pix, bits, paint, opaque);
+
+	} else if(b + db < 0 || b + db > 31) {
+		/* planar mode, always opaque */
+		int o[3], h[3], v[3];
+
+		o[0] = EXT6(bits >> 57);
+		o[1] = EXT7(((bits >> 50) & 0x40) | ((bits >> 49) & 0x3f));
+		o[2] = EXT6(((bits >> 43) & 0x20) | ((bits >> 40) & 0x18) | ((bits >> 39) & 7));
+		h[0] = EXT6(((bits >> 33) & 0x3e) | ((bits >> 32) & 1));
+		h[1] = EXT7(bits >> 25);
+		h[2] = EXT6(bits >> 19);
+		v[0] = EXT6(bits >> 13);
+		v[1] = EXT7(bits >> 6);
+		v[2] = EXT6(bits);
+
+		for(y=0; y<4; y++) {
+			for(x=0; x<4; x++) {
+				unsigned char *p = pix + (y * 4 + x) * 4;
+				for(i=0; i<3; i++) {
+					int c = (x * (h[i] - o[i]) + y * (v[i] - o[i]) + 4 * o[i] + 2) >> 2;
+					p[i] = CLAMP(c, 0, 255);
+				}
+				p[3] = 255;
+			}
+		}
+
+	} else {
+		base[0][0] = EXT5(r);
+		base[0][1] = EXT5(g);
+		base[0][2] = EXT5(b);
+		base[1][0] = EXT5(r + dr);
+		base[1][1] = EXT5(g + dg);
+		base[1][2] = EXT5(b + db);
+		etc_subblocks(pix, bits, base, opaque);
+	}
+}
+
+/* EAC block into channel chan. 11bit formats are reduced to 8 bits */
+static void decode_eac(const unsigned char *src, unsigned char *pix, int chan, int r11)
+{
+	int x, y;
+	uint64_t bits = load64be(src);
+	int base = bits >> 56;
+	int mul = (bits >> 52) & 0xf;
+	const int *mod = eac_mod[(bits >> 48) & 0xf];
+
+	for(x=0; x<4; x++) {
+		for(y=0; y<4; y++) {
+			int idx = (bits >> (45 - (x * 4 + y) * 3)) & 7;
+			int val;
+
+			if(r11) {
+				val = base * 8 + 4 + mod[idx] * (mul ? mul * 8 : 1);
+				val = (CLAMP(val, 0, 2047) * 255 + 1023) / 2047;
+			} else {
+				val = CLAMP(base + mod[idx] * mul, 0, 255);
+			}
+			pix[(y * 4 + x) * 4 + chan] = val;
+		}
+	}
+}
+
+/* BC7 (BPTC unorm) */
+struct bc7_mode {
+	int nsub, pbits, rotbits, selbit, cbits, abits, epbits, spbits, ibits, ibits2;
+};
+
+static const struct bc7_mode bc7_modes[8] = {
+	{3, 4, 0, 0, 4, 0, 1, 0, 3, 0},
+	{2, 6, 0, 0, 6, 0, 0, 1, 3, 0},
+	{3, 6, 0, 0, 5, 0, 0, 0, 2, 0},
+	{2, 6, 0, 0, 7, 0, 1, 0, 2, 0},
+	{1, 0, 2, 1, 5, 6, 0, 0, 2, 3},
+	{1, 0, 2, 0, 7, 8, 0, 0, 2, 2},
+	{1, 0, 0, 0, 7, 7, 1, 0, 4, 0},
+	{2, 6, 0, 0, 5, 5, 1, 0, 2, 0}
+};
+
+/* 2-subset partitions, bit i set if pixel i is in subset 1 */
+static const unsigned int bc7_part2[64] = {
+	0xcccc, 0x8888, 0xeeee, 0xecc8, 0xc880, 0xfeec, 0xfec8, 0xec80,
+	0xc800, 0xffec, 0xfe80, 0xe800, 0xffe8, 0xff00, 0xfff0, 0xf000,
+	0xf710, 0x008e, 0x7100, 0x08ce, 0x008c, 0x7310, 0x3100, 0x8cce,
+	0x088c, 0x3110, 0x6666, 0x366c, 0x17e8, 0x0ff0, 0x718e, 0x399c,
+	0xaaaa, 0xf0f0, 0x5a5a, 0x33cc, 0x3c3c, 0x55aa, 0x9696, 0xa55a,
+	0x73ce, 0x13c8, 0x324c, 0x3bdc, 0x6996, 0xc33c, 0x9966, 0x0660,
+	0x0272, 0x04e4, 0x4e40, 0x2720, 0xc936, 0x936c, 0x39c6, 0x639c,
+	0x9336, 0x9cc6, 0x817e, 0xe718, 0xccf0, 0x0fcc, 0x7744, 0xee22
+};
+
+/* 3-subset partitions, 2 bits per pixel */
+static const uint32_t bc7_part3[64] = {
+	0xaa685050, 0x6a5a5040, 0x5a5a4200, 0x5450a0a8, 0xa5a50000, 0xa0a05050, 0x5555a0a0, 0x5a5a5050,
+	0xaa550000, 0xaa555500, 0xaaaa5500, 0x90909090, 0x94949494, 0xa4a4a4a4, 0xa9a59450, 0x2a0a4250,
+	0xa5945040, 0x0a425054, 0xa5a5a500, 0x55a0a0a0, 0xa8a85454, 0x6a6a4040, 0xa4a45000, 0x1a1a0500,
+	0x0050a4a4, 0xaaa59090, 0x14696914, 0x69691400, 0xa08585a0, 0xaa821414, 0x50a4a450, 0x6a5a0200,
+	0xa9a58000, 0x5090a0a8, 0xa8a09050, 0x24242424, 0x00aa5500, 0x24924924, 0x24499224, 0x50a50a50,
+	0x500aa550, 0xaaaa4444, 0x66660000, 0xa5a0a5a0, 0x50a050a0, 0x69286928, 0x44aaaa44, 0x66666600,
+	0xaa444444, 0x54a854a8, 0x95809580, 0x96969600, 0xa85454a8, 0x80959580, 0xaa141414, 0x96960000,
+	0xaaaa1414, 0xa05050a0, 0xa0a5a5a0, 0x96000000, 0x40804080, 0xa9a8a9a8, 0xaaaaaa44, 0x2a4a5254
+};
+
+/* anchor pixels of the second subset (2 subsets), and second/third (3 subsets) */
+static const unsigned char bc7_anchor2[64] = {
+	15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+	15, 2, 8, 2, 2, 8, 8, 15, 2, 8, 2, 2, 8, 8, 2, 2,
+	15, 15, 6, 8, 2, 8, 15, 15, 2, 8, 2, 2, 2, 15, 15, 6,
+	6, 2, 6, 8, 15, 15, 2, 2, 15, 15, 15, 15, 15, 2, 2, 15
+};
+static const unsigned char bc7_anchor3a[64] = {
+	3, 3, 15, 15, 8, 3, 15, 15, 8, 8, 6, 6, 6, 5, 3, 3,
+	3, 3, 8, 15, 3, 3, 6, 10, 5, 8, 8, 6, 8, 5, 15, 15,
+	8, 15, 3, 5, 6, 10, 8, 15, 15, 3, 15, 5, 15, 15, 15, 15,
+	3, 15, 5, 5, 5, 8, 5, 10, 5, 10, 8, 13, 15, 12, 3, 3
+};
+static const unsigned char bc7_anchor3b[64] = {
+	15, 8, 8, 3, 15, 15, 3, 8, 15, 15, 15, 15, 15, 15, 15, 8,
+	15, 8, 15, 3, 15, 8, 15, 8, 3, 15, 6, 10, 15, 15, 10, 8,
+	15, 3, 15, 10, 10, 8, 9, 10, 6, 15, 8, 15, 3, 6, 6, 8,
+	15, 3, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 3, 15, 15, 8
+};
+
+static const int bc7_weights2[4] = {0, 21, 43, 64};
+static const int bc7_weights3[8] = {0, 9, 18, 27, 37, 46, 55, 64};
+static const int bc7_weights4[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+static unsigned int bc7_bits(const unsigned char *src, int *pos, int n)
+{
+	unsigned int v = 0;
+	int i;
+	for(i=0; i<n; i++) {
+		int b = *pos + i;
+		v |= ((src[b >> 3] >> (b & 7)) & 1) << i;
+	}
+	*pos += n;
+	return v;
+}
+
+static int bc7_interp(int e0, int e1, int idx, int nbits)
+{
+	const int *w = nbits == 2 ? bc7_weights2 : (nbits == 3 ? bc7_weights3 : bc7_weights4);
+	return ((64 - w[idx]) * e0 + w[idx] * e1 + 32) >> 6;
+}
+
+static void decode_bc7(const unsigned char *src, unsigned char *pix)
+{
+	int i, j, c, pos, mode, part = 0, rot = 0, sel = 0, prec;
+	int ep[6][4], subset[16], anchor[3], idx[16], idx2[16];
+	const struct bc7_mode *m;
+
+	for(mode=0; mode<8; mode++) {
+		if(src[0] & (1 << mode)) break;
+	}
+	if(mode >= 8) {
+		/* reserved mode, decodes to transparent black */
+		memset(pix, 0, 64);
+		return;
+	}
+	m = bc7_modes + mode;
+	pos = mode + 1;
+
+	part = bc7_bits(src, &pos, m->pbits);
+	rot = bc7_bits(src, &pos, m->rotbits);
+	sel = bc7_bits(src, &pos, m->selbit);
+
+	for(c=0; c<3; c++) {
+		for(i=0; i<m->nsub * 2; i++) {
+			ep[i][c] = bc7_bits(src, &pos, m->cbits);
+		}
+	}
+	for(i=0; i<m->nsub * 2; i++) {
+		ep[i][3] = m->abits ? bc7_bits(src, &pos, m->abits) : 255;
+	}
+
+	/* p-bits add one bit of precision below each endpoint */
+	if(m->epbits || m->spbits) {
+		int pb[6];
+		for(i=0; i<m->nsub * 2; i++) {
+			if(m->epbits) {
+				pb[i] = bc7_bits(src, &pos, 1);
+			} else if(!(i & 1)) {
+				pb[i] = pb[i + 1] = bc7_bits(src, &pos, 1);
+			}
+		}
+		for(i=0; i<m->nsub * 2; i++) {
+			for(c=0; c<3; c++) {
+				ep[i][c] = (ep[i][c] << 1) | pb[i];
+			}
+			if(m->abits) {
+				ep[i][3] = (ep[i][3] << 1) | pb[i];
+			}
+		}
+	}
+
+	/* expand endpoints to 8 bits */
+	prec = m->cbits + (m->epbits || m->spbits);
+	for(i=0; i<m->nsub * 2; i++) {
+		for(c=0; c<3; c++) {
+			ep[i][c] = (ep[i][c] << (8 - prec)) | (ep[i][c] >> (2 * prec - 8));
+		}
+		if(m->abits) {
+			int aprec = m->abits + (m->epbits || m->spbits);
+			ep[i][3] = (ep[i][3] << (8 - aprec)) | (ep[i][3] >> (2 * aprec - 8));
+		}
+	}
+
+	anchor[0] = 0;
+	anchor[1] = m->nsub == 3 ? bc7_anchor3a[part] : bc7_anchor2[part];
+	anchor[2] = bc7_anchor3b[part];
+	for(i=0; i<16; i++) {
+		switch(m->nsub) {
+		case 2:
+			subset[i] = (bc7_part2[part] >> i) & 1;
+			break;
+		case 3:
+			subset[i] = (bc7_part3[part] >> (i * 2)) & 3;
+			break;
+		default:
+			subset[i] = 0;
+		}
+	}
+
+	/* anchor indices drop their implicit top bit */
+	for(i=0; i<16; i++) {
+		int n = m->ibits;
+		for(j=0; j<m->nsub; j++) {
+			if(anchor[j] == i) n--;
+		}
+		idx[i] = bc7_bits(src, &pos, n);
+	}
+	for(i=0; i<16; i++) {
+		idx2[i] = m->ibits2 ? bc7_bits(src, &pos, i ? m->ibits2 : m->ibits2 - 1) : 0;
+	}
+
+	for(i=0; i<16; i++) {
+		unsigned char *p = pix + i * 4;
+		int *e0 = ep[subset[i] * 2];
+		int *e1 = ep[subset[i] * 2 + 1];
+		int tmp;
+
+		if(!m->ibits2) {
+			for(c=0; c<4; c++) {
+				p[c] = bc7_interp(e0[c], e1[c], idx[i], m->ibits);
+			}
+		} else {
+			/* modes 4 and 5: separate colour and alpha indices */
+			int ci = sel ? idx2[i] : idx[i];
+			int cb = sel ? m->ibits2 : m->ibits;
+			int ai = sel ? idx[i] : idx2[i];
+			int ab = sel ? m->ibits : m->ibits2;
+			for(c=0; c<3; c++) {
+				p[c] = bc7_interp(e0[c], e1[c], ci, cb);
+			}
+			p[3] = bc7_interp(e0[3], e1[3], ai, ab);
+		}
+
+		if(rot) {
+			tmp = p[3];
+			p[3] = p[rot - 1];
+			p[rot - 1] = tmp;
+		}
+	}
+}
+
+static void clear_block(unsigned char *pix)
+{
+	int i;
+	for(i=0; i<16; i++) {
+		pix[i * 4] = pix[i * 4 + 1] = pix[i * 4 + 2] = 0;
+		pix[i * 4 + 3] = 255;
+	}
+}
+
+static void decode_block(unsigned int fmt, const unsigned char *src, unsigned char *pix)
+{
+	int i;
+
+	switch(fmt) {
+	case TC_RGB_S3TC_DXT1:
+	case TC_SRGB_S3TC_DXT1:
+		decode_dxt_color(src, pix, DXT_OPAQUE);
+		break;
+
+	case TC_RGBA_S3TC_DXT1:
+	case TC_SRGB_ALPHA_S3TC_DXT1:
+		decode_dxt_color(src, pix, DXT_PUNCH);
+		break;
+
+	case TC_RGBA_S3TC_DXT3:
+	case TC_SRGB_ALPHA_S3TC_DXT3:
+		decode_dxt_color(src + 8, pix, DXT_FOUR);
+		for(i=0; i<16; i++) {
+			int a = (src[i / 2] >> ((i & 1) * 4)) & 0xf;
+			pix[i * 4 + 3] = a | (a << 4);
+		}
+		break;
+
+	case TC_RGBA_S3TC_DXT5:
+	case TC_SRGB_ALPHA_S3TC_DXT5:
+		decode_dxt_color(src + 8, pix, DXT_FOUR);
+		decode_bc4(src, pix, 3);
+		break;
+
+	case TC_RED_RGTC1:
+		clear_block(pix);
+		decode_bc4(src, pix, 0);
+		break;
+
+	case TC_RG_RGTC2:
+		clear_block(pix);
+		decode_bc4(src, pix, 0);
+		decode_bc4(src + 8, pix, 1);
+		break;
+
+	case TC_R11_EAC:
+		clear_block(pix);
+		decode_eac(src, pix, 0, 1);
+		break;
+
+	case TC_RG11_EAC:
+		clear_block(pix);
+		decode_eac(src, pix, 0, 1);
+		decode_eac(src + 8, pix, 1, 1);
+		break;
+
+	case TC_RGB8_ETC2:
+	case TC_SRGB8_ETC2:
+		decode_etc2(src, pix, 0);
+		break;
+
+	case TC_RGB8_PUNCHTHROUGH_ETC2:
+	case TC_SRGB8_PUNCHTHROUGH_ETC2:
+		decode_etc2(src, pix, 1);
+		break;
+
+	case TC_RGBA8_ETC2_EAC:
+	case TC_SRGB8_ALPHA8_ETC2_EAC:
+		decode_etc2(src + 8, pix, 0);
+		decode_eac(src, pix, 3, 0);
+		break;
+
+	case TC_RGBA_BPTC_UNORM:
+	case TC_SRGB_ALPHA_BPTC_UNORM:
+		decode_bc7(src, pix);
+		break;
+
+	default:
+		clear_block(pix);
+		break;
+	}
+}
+
+/* ---- encoders ---- */
+
+static unsigned int pack565(const float *rgb)
+{
+	int r = CLAMP((int)(rgb[0] * 31.0f / 255.0f + 0.5f), 0, 31);
+	int g = CLAMP((int)(rgb[1] * 63.0f / 255.0f + 0.5f), 0, 63);
+	int b = CLAMP((int)(rgb[2] * 31.0f / 255.0f + 0.5f), 0, 31);
+	return (r << 11) | (g << 5) | b;
+}
+
+static int color_dist(const unsigned char *a, const unsigned char *b)
+{
+	int dr = a[0] - b[0];
+	int dg = a[1] - b[1];
+	int db = a[2] - b[2];
+	return dr * dr + dg * dg + db * db;
+}
+
+/* BC1 colour block. Endpoints are picked along the principal axis of the
+ * block's colours. With punch set, pixels with alpha < 128 are encoded as
+ * transparent using the 3-colour mode.
+ */
+static void encode_bc1(const unsigned char *pix, unsigned char *dst, int punch)
+{
+	int i, j, k, num = 0, transp = 0;
+	float mean[3] = {0, 0, 0}, cov[6] = {0, 0, 0, 0, 0, 0};
+	float axis[3] = {1, 1, 1}, lo[3], hi[3];
+	float dmin = 1e30f, dmax = -1e30f;
+	unsigned int c0, c1, bits = 0;
+	unsigned char pal[4][4];
+
+	for(i=0; i<16; i++) {
+		const unsigned char *p = pix + i * 4;
+		if(punch && p[3] < 128) {
+			transp = 1;
+			continue;
+		}
+		for(j=0; j<3; j++) mean[j] += p[j];
+		num++;
+	}
+
+	if(!num) {
+		/* fully transparent block: 3-colour mode with every index at 3 */
+		memset(dst, 0, 4);
+		memset(dst + 4, 0xff, 4);
+		return;
+	}
+	for(j=0; j<3; j++) mean[j] /= num;
+
+	for(i=0; i<16; i++) {
+		const unsigned char *p = pix + i * 4;
+		float d[3];
+		if(punch && p[3] < 128) continue;
+
+		for(j=0; j<3; j++) d[j] = p[j] - mean[j];
+		cov[0] += d[0] * d[0];
+		cov[1] += d[0] * d[1];
+		cov[2] += d[0] * d[2];
+		cov[3] += d[1] * d[1];
+		cov[4] += d[1] * d[2];
+		cov[5] += d[2] * d[2];
+	}
+
+	/* a few rounds of power iteration are plenty for a 3x3 covariance */
+	for(k=0; k<4; k++) {
+		float x = axis[0] * cov[0] + axis[1] * cov[1] + axis[2] * cov[2];
+		float y = axis[0] * cov[1] + axis[1] * cov[3] + axis[2] * cov[4];
+		float z = axis[0] * cov[2] + axis[1] * cov[4] + axis[2] * cov[5];
+		float m = x * x + y * y + z * z;
+
+		if(m < 1e-6f) break;
+		m = 1.0f / sqrt(m);
+		axis[0] = x * m;
+		axis[1] = y * m;
+		axis[2] = z * m;
+	}
+
+	for(j=0; j<3; j++) lo[j] = hi[j] = mean[j];
+	for(i=0; i<16; i++) {
+		const unsigned char *p = pix + i * 4;
+		float d;
+		if(punch && p[3] < 128) continue;
+
+		d = (p[0] - mean[0]) * axis[0] + (p[1] - mean[1]) * axis[1] + (p[2] - mean[2]) * axis[2];
+		if(d < dmin) {
+			dmin = d;
+			for(j=0; j<3; j++) lo[j] = p[j];
+		}
+		if(d > dmax) {
+			dmax = d;
+			for(j=0; j<3; j++) hi[j] = p[j];
+		}
+	}
+
+	c0 = pack565(hi);
+	c1 = pack565(lo);
+
+	/* c0 > c1 selects 4-colour mode, c0 <= c1 the 3-colour + transparent one */
+	if(transp ? c0 > c1 : c0 < c1) {
+		unsigned int tmp = c0;
+		c0 = c1;
+		c1 = tmp;
+	}
+	dxt_palette(c0, c1, punch ? DXT_PUNCH : DXT_OPAQUE, pal);
+
+	for(i=0; i<16; i++) {
+		const unsigned char *p = pix + i * 4;
+		int best = 0, best_dist = color_dist(p, pal[0]);
+
+		if(transp && p[3] < 128) {
+			best = 3;
+		} else if(c0 != c1) {
+			for(j=1; j<(transp ? 3 : 4); j++) {
+				int d = color_dist(p, pal[j]);
+				if(d < best_dist) {
+					best_dist = d;
+					best = j;
+				}
+			}
+		}
+		bits |= best << (i * 2);
+	}
+
+	dst[0] = c0 & 0xff;
+	dst[1] = c0 >> 8;
+	dst[2] = c1 & 0xff;
+	dst[3] = c1 >> 8;
+	dst[4] = bits & 0xff;
+	dst[5] = (bits >> 8) & 0xff;
+	dst[6] = (bits >> 16) & 0xff;
+	dst[7] = bits >> 24;
+}
+
+/* BC4 style block from channel chan, always using the 8 value mode */
+static void encode_bc4(const unsigned char *pix, int chan, unsigned char *dst)
+{
+	int i, j;
+	unsigned int lo = 255, hi = 0, pal[8];
+	uint64_t bits = 0;
+
+	for(i=0; i<16; i++) {
+		unsigned int v = pix[i * 4 + chan];
+		if(v < lo) lo = v;
+		if(v > hi) hi = v;
+	}
+	bc4_palette(hi, lo, pal);
+
+	if(hi > lo) {
+		for(i=0; i<16; i++) {
+			int v = pix[i * 4 + chan];
+			int best = 0, best_dist = abs(v - (int)pal[0]);
+
+			for(j=1; j<8; j++) {
+				int d = abs(v - (int)pal[j]);
+				if(d < best_dist) {
+					best_dist = d;
+					best = j;
+				}
+			}
+			bits |= (uint64_t)best << (i * 3);
+		}
+	}
+
+	dst[0] = hi;
+	dst[1] = lo;
+	for(i=0; i<6; i++) {
+		dst[i + 2] = (bits >> (i * 8)) & 0xff;
+	}
+}
+
+static void encode_block(unsigned int fmt, const unsigned char *pix, unsigned char *dst)
+{
+	switch(fmt) {
+	case TC_RGB_S3TC_DXT1:
+	case TC_SRGB_S3TC_DXT1:
+		encode_bc1(pix, dst, 0);
+		break;
+
+	case TC_RGBA_S3TC_DXT1:
+	case TC_SRGB_ALPHA_S3TC_DXT1:
+		encode_bc1(pix, dst, 1);
+		break;
+
+	case TC_RGBA_S3TC_DXT5:
+	case TC_SRGB_ALPHA_S3TC_DXT5:
+		encode_bc4(pix, 3, dst);
+		encode_bc1(pix, dst + 8, 0);
+		break;
+
+	case TC_RED_RGTC1:
+		encode_bc4(pix, 0, dst);
+		break;
+
+	case TC_RG_RGTC2:
+		encode_bc4(pix, 0, dst);
+		encode_bc4(pix, 1, dst + 8);
+		break;
+
+	default:
+		break;
+	}
+}
@@ -0,0 +1,55 @@
+#ifndef TRANSCODE_H_
+#define TRANSCODE_H_
+
+/* GL format enums used by the CPU transcoder. Kept here as plain numbers so
+ * the transcoder doesn't need to pull in any GL headers.
+ */
+#define TC_RGBA8					0x8058
+#define TC_SRGB8_ALPHA8				0x8c43
+#define TC_RGB_S3TC_DXT1			0x83f0
+#define TC_RGBA_S3TC_DXT1			0x83f1
+#define TC_RGBA_S3TC_DXT3			0x83f2
+#define TC_RGBA_S3TC_DXT5			0x83f3
+#define TC_SRGB_S3TC_DXT1			0x8c4c
+#define TC_SRGB_ALPHA_S3TC_DXT1		0x8c4d
+#define TC_SRGB_ALPHA_S3TC_DXT3		0x8c4e
+#define TC_SRGB_ALPHA_S3TC_DXT5		0x8c4f
+#define TC_RED_RGTC1				0x8dbb
+#define TC_RG_RGTC2					0x8dbd
+#define TC_R11_EAC					0x9270
+#define TC_RG11_EAC					0x9272
+#define TC_RGB8_ETC2				0x9274
+#define TC_SRGB8_ETC2				0x9275
+#define TC_RGB8_PUNCHTHROUGH_ETC2	0x9276
+#define TC_SRGB8_PUNCHTHROUGH_ETC2	0x9277
+#define TC_RGBA8_ETC2_EAC			0x9278
+#define TC_SRGB8_ALPHA8_ETC2_EAC	0x9279
+#define TC_RGBA_BPTC_UNORM			0x8e8c
+#define TC_SRGB_ALPHA_BPTC_UNORM	0x8e8d
+
+/* size in bytes of a 4x4 block of fmt, or 0 if it's not a 4x4 block format */
+int transcode_block_size(unsigned int fmt);
+/* non-zero if fmt is a block-compressed format */
+int transcode_is_compressed(unsigned int fmt);
+/* non-zero if fmt is one of the uncompressed RGBA8 formats */
+int transcode_is_uncompressed(unsigned int fmt);
+/* size in bytes of a width x height image in fmt (0 if unknown) */
+unsigned int transcode_level_size(unsigned int fmt, int width, int height);
+
+/* non-zero if the CPU transcoder can decode fmt */
+int transcode_can_decode(unsigned int fmt);
+
+/* pick the best format out of fmtlist (the driver's compressed formats) to
+ * transcode srcfmt into. Falls back to uncompressed RGBA8 when none of the
+ * supported compressed formats fit. Returns 0 if srcfmt can't be decoded.
+ */
+unsigned int transcode_target(unsigned int srcfmt, const int *fmtlist, int num_fmt);
+
+/* transcode one width x height image from srcfmt to dstfmt, splitting the
+ * block rows across nthreads worker threads (0: one per CPU).
+ * dst must be at least transcode_level_size(dstfmt, width, height) bytes.
+ */
+int transcode(unsigned int srcfmt, const void *src, unsigned int dstfmt, void *dst,
+		int width, int height, int nthreads);
+
+#endif	/* TRANSCODE_H_ */
@@ -0,0 +1,311 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <GL/glew.h>
+#include <GL/freeglut.h>
+#include "view.h"
+#include "texture.h"
+#include "sdr.h"
+
+struct vertex {
+	float x, y;
+	float s, t, lod;
+};
+
+static const char *vsdr_src =
+	"#version 140\n"
+	"uniform vec2 scale;\n"
+	"in vec2 attr_pos;\n"
+	"in vec3 attr_tex;\n"
+	"out vec3 tc;\n"
+	"void main()\n"
+	"{\n"
+	"	gl_Position = vec4(attr_pos * scale - 1.0, 0.0, 1.0);\n"
+	"	tc = attr_tex;\n"
+	"}\n";
+
+static const char *psdr_src =
+	"#version 140\n"
+	"uniform sampler2D tex;\n"
+	"in vec3 tc;\n"
+	"out vec4 color;\n"
+	"void main()\n"
+	"{\n"
+	"	color = textureLod(tex, tc.xy, tc.z);\n"
+	"}\n";
+
+enum { ATTR_POS, ATTR_TEX };	/* bound in the order of attr_names */
+
+#define MAX_QUADS	MAX_LEVELS
+
+static unsigned int prog, vbo, vao;
+static int scale_loc;
+static int win_width, win_height;
+
+/* the layout in the vertex buffer is for a texture of this size */
+static int lay_width, lay_height;
+static int num_verts;
+static long texels;		/* pixels covered by one instance */
+
+/* without OpenGL 3.1 the quads are drawn in immediate mode, and each one
+ * shows whatever level minification picks for it
+ */
+static int fixed_func;
+
+/* draw timing, with timer queries when available. The result of a query is
+ * read back two frames later, so that it's done by then and doesn't stall.
+ */
+#define NUM_QUERIES	2
+static unsigned int queries[NUM_QUERIES];
+static long query_texels[NUM_QUERIES];
+static int have_timer, cur_query;
+static double start_time, acc_time;
+static int acc_draws;
+static long acc_texels;
+static double draw_msec, texel_rate;
+static int cur_instances;
+
+
+int view_init(int instanced)
+{
+	static const char *attr_names[] = {"attr_pos", "attr_tex", 0};
+
+	if((have_timer = GLEW_VERSION_3_3 || GLEW_ARB_timer_query)) {
+		glGenQueries(NUM_QUERIES, queries);
+		memset(query_texels, 0, sizeof query_texels);
+	}
+	start_time = 0.0;
+
+	if(!GLEW_VERSION_3_1) {
+		if(instanced) {
+			fprintf(stderr, "instanced drawing of the mip chain needs OpenGL 3.1\n");
+			return -1;
+		}
+		printf("no OpenGL 3.1, drawing the mip chain in immediate mode\n");
+		fixed_func = 1;
+		return 0;
+	}
+
+	if(!(prog = create_program(vsdr_src, psdr_src, attr_names))) {
+		return -1;
+	}
+	scale_loc = glGetUniformLocation(prog, "scale");
+	glUseProgram(prog);
+	glUniform1i(glGetUniformLocation(prog, "tex"), 0);
+	glUseProgram(0);
+
+	glGenVertexArrays(1, &vao);
+	glBindVertexArray(vao);
+	glGenBuffers(1, &vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	glBufferData(GL_ARRAY_BUFFER, MAX_QUADS * 6 * sizeof(struct vertex), 0, GL_STATIC_DRAW);
+	glVertexAttribPointer(ATTR_POS, 2, GL_FLOAT, GL_FALSE, sizeof(struct vertex), 0);
+	glVertexAttribPointer(ATTR_TEX, 3, GL_FLOAT, GL_FALSE, sizeof(struct vertex),
+			(void*)offsetof(struct vertex, s));
+	glEnableVertexAttribArray(ATTR_POS);
+	glEnableVertexAttribArray(ATTR_TEX);
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	lay_width = lay_height = 0;
+	return 0;
+}
+
+void view_destroy(void)
+{
+	if(have_timer) {
+		glDeleteQueries(NUM_QUERIES, queries);
+		have_timer = 0;
+	}
+	if(prog) {
+		glDeleteProgram(prog);
+		glDeleteBuffers(1, &vbo);
+		glDeleteVertexArrays(1, &vao);
+		prog = 0;
+	}
+}
+
+void view_resize(int width, int height)
+{
+	win_width = width;
+	win_height = height;
+
+	if(fixed_func) {
+		glMatrixMode(GL_PROJECTION);
+		glLoadIdentity();
+		glOrtho(0, width, 0, height, -1, 1);
+	}
+}
+
+/* level 0 on the left, every following level stacked to the right of it,
+ * each one half the size of the previous, sampled at its own LOD
+ */
+static void layout(int width, int height)
+{
+	int i, x, y, xsz, ysz;
+	struct vertex verts[MAX_QUADS * 6], *vptr = verts;
+	float lod;
+
+	x = y = 0;
+	xsz = width;
+	ysz = height;
+	texels = 0;
+
+	for(i=0; i<MAX_QUADS && xsz && ysz; i++) {
+		lod = (float)i;
+
+		vptr[0].x = x;			vptr[0].y = y;			vptr[0].s = 0; vptr[0].t = 1;
+		vptr[1].x = x + xsz;	vptr[1].y = y;			vptr[1].s = 1; vptr[1].t = 1;
+		vptr[2].x = x + xsz;	vptr[2].y = y + ysz;	vptr[2].s = 1; vptr[2].t = 0;
+		vptr[3] = vptr[0];
+		vptr[4] = vptr[2];
+		vptr[5].x = x;			vptr[5].y = y + ysz;	vptr[5].s = 0; vptr[5].t = 0;
+		vptr[0].lod = vptr[1].lod = vptr[2].lod = vptr[3].lod = vptr[4].lod = vptr[5].lod = lod;
+		vptr += 6;
+
+		texels += (long)xsz * ysz;
+
+		if(i == 0) {
+			x += xsz;
+		} else {
+			y += ysz;
+		}
+		xsz /= 2;
+		ysz /= 2;
+	}
+	num_verts = vptr - verts;
+
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, num_verts * sizeof *verts, verts);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	lay_width = width;
+	lay_height = height;
+}
+
+static void draw_fixed(int width, int height, int instances)
+{
+	int i, n, x, y, xsz, ysz;
+
+	texels = 0;
+
+	glEnable(GL_TEXTURE_2D);
+	glBegin(GL_QUADS);
+	for(n=0; n<instances; n++) {
+		x = y = 0;
+		xsz = width;
+		ysz = height;
+
+		for(i=0; i<MAX_QUADS && xsz && ysz; i++) {
+			glTexCoord2f(0, 1); glVertex2f(x, y);
+			glTexCoord2f(1, 1); glVertex2f(x + xsz, y);
+			glTexCoord2f(1, 0); glVertex2f(x + xsz, y + ysz);
+			glTexCoord2f(0, 0); glVertex2f(x, y + ysz);
+
+			if(n == 0) {
+				texels += (long)xsz * ysz;
+			}
+
+			if(i == 0) {
+				x += xsz;
+			} else {
+				y += ysz;
+			}
+			xsz /= 2;
+			ysz /= 2;
+		}
+	}
+	glEnd();
+	glDisable(GL_TEXTURE_2D);
+}
+
+static void draw(unsigned int tex, int width, int height, int instances)
+{
+	glBindTexture(GL_TEXTURE_2D, tex);
+
+	if(fixed_func) {
+		draw_fixed(width, height, instances);
+		return;
+	}
+
+	if(width != lay_width || height != lay_height) {
+		layout(width, height);
+	}
+
+	glUseProgram(prog);
+	glUniform2f(scale_loc, 2.0f / win_width, 2.0f / win_height);
+
+	glBindVertexArray(vao);
+	if(instances > 1) {
+		glDrawArraysInstanced(GL_TRIANGLES, 0, num_verts, instances);
+	} else {
+		glDrawArrays(GL_TRIANGLES, 0, num_verts);
+	}
+	glBindVertexArray(0);
+	glUseProgram(0);
+}
+
+void view_draw(unsigned int tex, int width, int height, int instances)
+{
+	double now, t0;
+	GLuint64 nsec;
+	unsigned int q;
+
+	/* only the draw itself is timed, swapping and waiting for vsync would
+	 * swamp the sampling cost
+	 */
+	if(have_timer) {
+		q = queries[cur_query];
+		if(query_texels[cur_query]) {
+			glGetQueryObjectui64v(q, GL_QUERY_RESULT, &nsec);
+			acc_time += nsec / 1000000.0;
+			acc_texels += query_texels[cur_query];
+			acc_draws++;
+		}
+		glBeginQuery(GL_TIME_ELAPSED, q);
+		draw(tex, width, height, instances);
+		glEndQuery(GL_TIME_ELAPSED);
+
+		query_texels[cur_query] = texels * instances;
+		cur_query = (cur_query + 1) % NUM_QUERIES;
+	} else {
+		glFinish();
+		t0 = get_msec();
+		draw(tex, width, height, instances);
+		glFinish();
+		acc_time += get_msec() - t0;
+		acc_texels += texels * instances;
+		acc_draws++;
+	}
+	cur_instances = instances;
+
+	now = get_msec();
+	if(start_time <= 0.0) {
+		start_time = now;
+	}
+	if(now - start_time >= 500.0 && acc_draws && acc_time > 0.0) {
+		draw_msec = acc_time / acc_draws;
+		texel_rate = acc_texels / acc_time * 1000.0;
+		start_time = now;
+		acc_time = 0.0;
+		acc_draws = 0;
+		acc_texels = 0;
+	}
+}
+
+void view_draw_overlay(const char *label)
+{
+	char buf[256];
+
+	if(draw_msec > 0.0) {
+		sprintf(buf, "%s  %.3f ms/draw  %d instance%s  %.1f Mtexels/s", label,
+				draw_msec, cur_instances, cur_instances == 1 ? "" : "s", texel_rate / 1e6);
+	} else {
+		sprintf(buf, "%s  %d instance%s", label, cur_instances, cur_instances == 1 ? "" : "s");
+	}
+
+	glColor3f(1, 1, 0);
+	glWindowPos2i(8, win_height - 20);
+	glutBitmapString(GLUT_BITMAP_9_BY_15, (unsigned char*)buf);
+	glColor3f(1, 1, 1);
+}
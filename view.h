@@ -0,0 +1,22 @@
+#ifndef VIEW_H_
+#define VIEW_H_
+
+/* mip-chain visualizer: every level of a texture side by side, each quad
+ * sampling its own level explicitly, drawn from a vertex buffer in a single
+ * (optionally instanced) call. Needs OpenGL 3.1, without it the quads are
+ * drawn in immediate mode, unless instanced is set and view_init fails.
+ */
+
+int view_init(int instanced);
+void view_destroy(void);
+void view_resize(int width, int height);
+
+/* draw the mip chain of a width x height texture instances times over */
+void view_draw(unsigned int tex, int width, int height, int instances);
+
+/* time taken by the draw on the GPU, and texels sampled per second,
+ * averaged over the last half second or so. label goes first on the line.
+ */
+void view_draw_overlay(const char *label);
+
+#endif	/* VIEW_H_ */